@@ -0,0 +1,521 @@
+#include "route_checks.h"
+#include "scene_factory.h"
+#include "occupancy_grid.h"
+#include "i_scene.h"
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <random>
+
+namespace {
+
+const int kMaxReported = 10;
+
+// Запас вокруг препятствий и концов маршрутов больше, чем у построителей:
+// путь, вышедший за их область поиска, тоже оценивается
+const int kExtentMargin = 8;
+
+// Как в генераторах сцен: результат не зависит от стандартной библиотеки
+int randomInt(std::mt19937& rng, int lo, int hi)
+{
+    return lo + static_cast<int>(rng() % static_cast<quint32>(hi - lo + 1));
+}
+
+// Узлы сетки, покрывающие препятствия и концы маршрутов, с запасом
+QRect cellExtent(const std::vector<QRect>& obstacles, const std::vector<std::pair<QPoint, QPoint>>& queries,
+                 int step)
+{
+    QRect extent;
+    for (const QRect& obstacle : obstacles)
+    {
+        QRect cells = OccupancyGrid::blockedCells(obstacle, step);
+        if (cells.isValid())
+            extent |= cells;
+    }
+    for (const auto& query : queries)
+    {
+        QPoint a = OccupancyGrid::toCell(query.first, step);
+        QPoint b = OccupancyGrid::toCell(query.second, step);
+        extent |= QRect(a, a);
+        extent |= QRect(b, b);
+    }
+    return extent.adjusted(-kExtentMargin, -kExtentMargin, kExtentMargin, kExtentMargin);
+}
+
+// Цена пути по правилам GridSettings, посчитанная без участия построителей
+class PathCost {
+public:
+    PathCost(const std::vector<QRect>& obstacles, const GridSettings& grid, const QRect& extent)
+        : m_settings(grid)
+    {
+        m_cells.build(obstacles, grid.cellSize, extent);
+    }
+
+    // Цена пути или -1, если путь не идет по соседним узлам сетки или проходит
+    // через препятствие. Узел начала не проверяется
+    qint64 cost(const std::vector<QPoint>& path) const
+    {
+        const int step = m_settings.cellSize;
+        qint64 total = 0;
+        int previous = -1;
+        for (size_t i = 1; i < path.size(); ++i)
+        {
+            QPoint delta = path[i] - path[i - 1];
+            if (delta.manhattanLength() != step || path[i].x() % step != 0 || path[i].y() % step != 0)
+                return -1;
+
+            QPoint cell = OccupancyGrid::toCell(path[i], step);
+            if (m_cells.isBlocked(cell.x(), cell.y()))
+                return -1;
+
+            int direction = delta.x() > 0 ? 0 : delta.x() < 0 ? 1 : delta.y() > 0 ? 2 : 3;
+            total += m_settings.stepCost;
+            if (isNear(cell))
+                total += m_settings.nearObstacleCost;
+            if (previous != -1 && previous != direction)
+                total += m_settings.turnCost;
+            previous = direction;
+        }
+        return total;
+    }
+
+    // Цена кратчайшего пути между узлами перебором Дейкстры по состояниям
+    // (узел, направление последнего шага) или -1, если цель недостижима
+    qint64 shortest(const QPoint& startCell, const QPoint& goalCell) const
+    {
+        if (!m_cells.contains(startCell.x(), startCell.y()) || !m_cells.contains(goalCell.x(), goalCell.y())
+            || m_cells.isBlocked(goalCell.x(), goalCell.y()))
+            return -1;
+
+        const int dx[4] = { 1, -1, 0, 0 };
+        const int dy[4] = { 0, 0, 1, -1 };
+        typedef std::pair<qint64, int> Entry;
+        std::vector<qint64> distance(static_cast<size_t>(m_cells.cellCount()) * 4, -1);
+        std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> open;
+
+        // Первый шаг поворотом не считается
+        const int start = m_cells.indexOf(startCell.x(), startCell.y());
+        for (int direction = 0; direction < 4; ++direction)
+        {
+            distance[start * 4 + direction] = 0;
+            open.push(Entry(0, start * 4 + direction));
+        }
+
+        while (!open.empty())
+        {
+            Entry top = open.top();
+            open.pop();
+            if (top.first != distance[top.second])
+                continue;
+
+            const QPoint cell = m_cells.cellAt(top.second / 4);
+            if (cell == goalCell)
+                return top.first;
+
+            for (int next = 0; next < 4; ++next)
+            {
+                const int x = cell.x() + dx[next];
+                const int y = cell.y() + dy[next];
+                if (!m_cells.contains(x, y) || m_cells.isBlocked(x, y))
+                    continue;
+
+                qint64 cost = top.first + m_settings.stepCost;
+                if (isNear(QPoint(x, y)))
+                    cost += m_settings.nearObstacleCost;
+                if (next != top.second % 4)
+                    cost += m_settings.turnCost;
+
+                const int state = m_cells.indexOf(x, y) * 4 + next;
+                if (distance[state] < 0 || cost < distance[state]) {
+                    distance[state] = cost;
+                    open.push(Entry(cost, state));
+                }
+            }
+        }
+        return -1;
+    }
+
+private:
+    bool isNear(const QPoint& cell) const
+    {
+        for (int dy = -1; dy <= 1; ++dy)
+        {
+            for (int dx = -1; dx <= 1; ++dx)
+            {
+                int x = cell.x() + dx;
+                int y = cell.y() + dy;
+                if ((dx != 0 || dy != 0) && m_cells.contains(x, y) && m_cells.isBlocked(x, y))
+                    return true;
+            }
+        }
+        return false;
+    }
+
+    OccupancyGrid m_cells;
+    GridSettings m_settings;
+};
+
+struct CheckedBuilder {
+    RoutingAlgorithm algorithm;
+    const char* name;
+    bool shortest;
+};
+
+const CheckedBuilder kCheckedBuilders[] = {
+    { RoutingAlgorithm::JumpPoint, "jps", true },
+    { RoutingAlgorithm::JumpPointTables, "jps+", true },
+    { RoutingAlgorithm::BidirectionalBfs, "bibfs", true },
+    { RoutingAlgorithm::BidirectionalAStar, "biastar", true },
+    { RoutingAlgorithm::Hierarchical, "hpa", false }
+};
+
+// Мелкая сцена: препятствия со сдвигом от узлов сетки и концы маршрутов
+// между узлами, в том числе совпадающие
+SyntheticScene randomScene(std::mt19937& rng, int step)
+{
+    SyntheticScene scene;
+    scene.name = "random";
+    scene.widthCells = 20;
+    scene.heightCells = 20;
+
+    int count = randomInt(rng, 0, 40);
+    for (int i = 0; i < count; ++i)
+    {
+        int x = randomInt(rng, -2, 17) * step;
+        int y = randomInt(rng, -2, 17) * step;
+        scene.obstacles.push_back(QRect(QPoint(x, y), QPoint(x + randomInt(rng, 0, 3) * step + randomInt(rng, 0, 2),
+                                                             y + randomInt(rng, 0, 3) * step + randomInt(rng, 0, 2))));
+    }
+
+    for (int i = 0; i < 10; ++i)
+    {
+        QPoint a(randomInt(rng, -3, 20) * step + randomInt(rng, 0, step - 1), randomInt(rng, -3, 20) * step);
+        QPoint b(randomInt(rng, -3, 20) * step, randomInt(rng, -3, 20) * step + randomInt(rng, 0, step - 1));
+        scene.queries.emplace_back(a, b);
+    }
+    QPoint same(2 * step, 2 * step);
+    scene.queries.emplace_back(same, same);
+    return scene;
+}
+
+}
+
+namespace RouteChecks {
+
+Result compareBuilders(const SyntheticScene& scene, const GridSettings& grid)
+{
+    const int step = grid.cellSize;
+    std::unique_ptr<IRouteBuilder> reference = SceneFactory::createRouteBuilder(RoutingAlgorithm::AStar, grid);
+    std::vector<std::unique_ptr<IRouteBuilder>> builders;
+    for (const CheckedBuilder& checked : kCheckedBuilders)
+        builders.push_back(SceneFactory::createRouteBuilder(checked.algorithm, grid));
+
+    PathCost pathCost(scene.obstacles, grid, cellExtent(scene.obstacles, scene.queries, step));
+    Result result;
+
+    auto report = [&](const char* name, const std::pair<QPoint, QPoint>& query, const QString& problem) {
+        if (++result.mismatches <= kMaxReported)
+            std::fprintf(stderr, "%s %s (%d, %d) -> (%d, %d): %s\n", qPrintable(scene.name), name,
+                         query.first.x(), query.first.y(), query.second.x(), query.second.y(),
+                         qPrintable(problem));
+    };
+
+    for (const auto& query : scene.queries)
+    {
+        const QPoint start = OccupancyGrid::toCell(query.first, step) * step;
+        const QPoint goal = OccupancyGrid::toCell(query.second, step) * step;
+
+        std::vector<QPoint> expected = reference->buildRoute(query.first, query.second, scene.obstacles);
+        const bool reached = reference->lastSearchStats().reached;
+        const qint64 expectedCost = reached ? pathCost.cost(expected) : -1;
+        ++result.checks;
+        if (reached && expectedCost < 0)
+            report("astar", query, "path leaves the grid or crosses an obstacle");
+
+        for (size_t i = 0; i < builders.size(); ++i)
+        {
+            const CheckedBuilder& checked = kCheckedBuilders[i];
+            std::vector<QPoint> path = builders[i]->buildRoute(query.first, query.second, scene.obstacles);
+            ++result.checks;
+
+            if (builders[i]->lastSearchStats().reached != reached) {
+                report(checked.name, query, reached ? "no path, A* found one" : "path found, A* found none");
+                continue;
+            }
+
+            // Недостижимый маршрут - отрезок между исходными концами
+            if (!reached) {
+                if (path != expected)
+                    report(checked.name, query, "unreachable route differs from A*");
+                continue;
+            }
+
+            const qint64 cost = pathCost.cost(path);
+            if (cost < 0)
+                report(checked.name, query, "path leaves the grid or crosses an obstacle");
+            else if (path.front() != start || path.back() != goal)
+                report(checked.name, query, "path does not connect the route ends");
+            else if (checked.shortest && cost != expectedCost)
+                report(checked.name, query, QString("cost %1, A* %2").arg(cost).arg(expectedCost));
+        }
+    }
+
+    // Пакет с общим началом: маршрут не должен менять форму оттого, что его
+    // перестроили вместе с другими
+    std::vector<RouteEndpoints> batch;
+    for (const auto& query : scene.queries)
+        batch.emplace_back(scene.queries.front().first, query.second);
+
+    auto compareBatch = [&](const char* name, IRouteBuilder& builder) {
+        std::vector<std::vector<QPoint>> paths = builder.buildRoutes(batch, scene.obstacles);
+        for (size_t k = 0; k < batch.size(); ++k)
+        {
+            ++result.checks;
+            if (builder.buildRoute(batch[k].first, batch[k].second, scene.obstacles) != paths[k])
+                report(name, batch[k], "batch path differs from a single query");
+        }
+    };
+
+    compareBatch("astar", *reference);
+    for (size_t i = 0; i < builders.size(); ++i)
+        compareBatch(kCheckedBuilders[i].name, *builders[i]);
+
+    return result;
+}
+
+Result compareBuildersOnRandomScenes(quint32 seed, int sceneCount, const GridSettings& grid)
+{
+    std::mt19937 rng(seed);
+    Result result;
+    for (int i = 0; i < sceneCount; ++i)
+        result.add(compareBuilders(randomScene(rng, grid.cellSize), grid));
+    return result;
+}
+
+Result compareWeighted(quint32 seed, int sceneCount, int cellSize)
+{
+    std::mt19937 rng(seed);
+    Result result;
+    for (int i = 0; i < sceneCount; ++i)
+    {
+        GridSettings grid;
+        grid.cellSize = cellSize;
+        grid.stepCost = randomInt(rng, 1, 3);
+        grid.nearObstacleCost = randomInt(rng, 0, 5);
+        grid.turnCost = randomInt(rng, grid.nearObstacleCost == 0 ? 1 : 0, 7);
+
+        SyntheticScene scene = randomScene(rng, cellSize);
+        std::unique_ptr<IRouteBuilder> builder = SceneFactory::createRouteBuilder(RoutingAlgorithm::AStar, grid);
+        PathCost pathCost(scene.obstacles, grid, cellExtent(scene.obstacles, scene.queries, cellSize));
+
+        auto report = [&](const std::pair<QPoint, QPoint>& query, const QString& problem) {
+            if (++result.mismatches <= kMaxReported)
+                std::fprintf(stderr, "weighted step %d near %d turn %d (%d, %d) -> (%d, %d): %s\n",
+                             grid.stepCost, grid.nearObstacleCost, grid.turnCost, query.first.x(), query.first.y(),
+                             query.second.x(), query.second.y(), qPrintable(problem));
+        };
+
+        for (const auto& query : scene.queries)
+        {
+            const QPoint startCell = OccupancyGrid::toCell(query.first, cellSize);
+            const QPoint goalCell = OccupancyGrid::toCell(query.second, cellSize);
+            std::vector<QPoint> path = builder->buildRoute(query.first, query.second, scene.obstacles);
+            const bool reached = builder->lastSearchStats().reached;
+            const qint64 expected = pathCost.shortest(startCell, goalCell);
+            ++result.checks;
+
+            if (expected < 0) {
+                if (reached)
+                    report(query, "path found, exhaustive search found none");
+                continue;
+            }
+
+            const qint64 cost = pathCost.cost(path);
+            if (!reached)
+                report(query, "no path, exhaustive search found one");
+            else if (cost < 0 || path.front() != startCell * cellSize || path.back() != goalCell * cellSize)
+                report(query, "path does not connect the route ends over free nodes");
+            else if (cost != expected)
+                report(query, QString("cost %1, exhaustive search %2").arg(cost).arg(expected));
+        }
+
+        // Пакет с общим началом ищется по одному маршруту: те же пути, что и у одиночных запросов
+        std::vector<RouteEndpoints> batch;
+        for (const auto& query : scene.queries)
+            batch.emplace_back(scene.queries.front().first, query.second);
+        std::vector<std::vector<QPoint>> paths = builder->buildRoutes(batch, scene.obstacles);
+        for (size_t k = 0; k < batch.size(); ++k)
+        {
+            ++result.checks;
+            if (builder->buildRoute(batch[k].first, batch[k].second, scene.obstacles) != paths[k])
+                report(batch[k], "batch path differs from a single query");
+        }
+    }
+    return result;
+}
+
+Result checkSceneEdits(quint32 seed, const GridSettings& grid)
+{
+    const int step = grid.cellSize;
+    std::mt19937 rng(seed);
+    std::unique_ptr<IScene> scene = SceneFactory::createScene(RoutingAlgorithm::AStar, grid);
+    std::unique_ptr<IRouteBuilder> fresh = SceneFactory::createRouteBuilder(RoutingAlgorithm::AStar, grid);
+
+    auto randomObstacle = [&]() {
+        int x = randomInt(rng, 0, 39) * step;
+        int y = randomInt(rng, 0, 39) * step;
+        return QRect(QPoint(x, y), QPoint(x + randomInt(rng, 0, 5) * step + 1, y + randomInt(rng, 0, 5) * step + 1));
+    };
+
+    std::vector<int> obstacleIds;
+    for (int i = 0; i < 25; ++i)
+        obstacleIds.push_back(scene->addObstacle(randomObstacle()));
+
+    std::vector<int> pointIds;
+    for (int i = 0; i < 60; ++i)
+        pointIds.push_back(scene->addPoint(QPoint(randomInt(rng, 0, 39) * step, randomInt(rng, 0, 39) * step)));
+    for (int i = 0; i < 150; ++i)
+        scene->buildRoute(pointIds[randomInt(rng, 0, 59)], pointIds[randomInt(rng, 0, 59)]);
+
+    Result result;
+    for (int edit = 0; edit < 40; ++edit)
+    {
+        // Маршруты сдвинутой точки перестраиваются заново, поэтому их путь
+        // должен совпасть с новым поиском, а не только по стоимости
+        int kind = randomInt(rng, 0, 2);
+        int movedId = -1;
+        if (kind == 0 && !obstacleIds.empty()) {
+            size_t index = static_cast<size_t>(randomInt(rng, 0, static_cast<int>(obstacleIds.size()) - 1));
+            scene->removeElement(obstacleIds[index]);
+            obstacleIds.erase(obstacleIds.begin() + index);
+        } else if (kind == 1) {
+            obstacleIds.push_back(scene->addObstacle(randomObstacle()));
+        } else {
+            int id = pointIds[randomInt(rng, 0, 59)];
+            QPoint position;
+            scene->getPointPosition(id, position);
+            QPoint offset(randomInt(rng, -2, 2) * step, randomInt(rng, -2, 2) * step);
+            scene->movePoint(id, position + offset);
+            if (!offset.isNull())
+                movedId = id;
+        }
+        scene->rebuildRoutes();
+
+        const std::vector<QRect>& obstacles = scene->getObstacles();
+        std::vector<std::pair<QPoint, QPoint>> ends;
+        for (const Route& route : scene->getRouteList())
+        {
+            QPoint a;
+            QPoint b;
+            scene->getPointPosition(route.getStartId(), a);
+            scene->getPointPosition(route.getEndId(), b);
+            ends.emplace_back(a, b);
+        }
+        PathCost pathCost(obstacles, grid, cellExtent(obstacles, ends, step));
+
+        for (size_t i = 0; i < ends.size(); ++i)
+        {
+            const Route& route = scene->getRouteList()[i];
+            std::vector<QPoint> expected = fresh->buildRoute(ends[i].first, ends[i].second, obstacles);
+            const bool reached = fresh->lastSearchStats().reached;
+            std::vector<QPoint> path = route.getPath();
+            ++result.checks;
+
+            QString problem;
+            if (!reached) {
+                if (path != expected)
+                    problem = "route kept a path, a fresh search finds none";
+            } else {
+                const qint64 cost = pathCost.cost(path);
+                const qint64 expectedCost = pathCost.cost(expected);
+                if (cost < 0)
+                    problem = "route leaves the grid or crosses an obstacle";
+                else if (path.front() != expected.front() || path.back() != expected.back())
+                    problem = "route does not connect its points";
+                else if (cost != expectedCost)
+                    problem = QString("cost %1, fresh search %2").arg(cost).arg(expectedCost);
+                else if (path != expected && (route.getStartId() == movedId || route.getEndId() == movedId))
+                    problem = "route takes another path than a fresh search";
+            }
+
+            if (!problem.isEmpty() && ++result.mismatches <= kMaxReported)
+                std::fprintf(stderr, "scene edits seed %u edit %d route %d: %s\n", seed, edit, route.getId(),
+                             qPrintable(problem));
+        }
+    }
+
+    return result;
+}
+
+Result checkObstacleUpdates(quint32 seed, int cellSize)
+{
+    const int step = cellSize;
+    std::mt19937 rng(seed);
+    GridSettings grid;
+    grid.cellSize = cellSize;
+    std::unique_ptr<IRouteBuilder> builder = SceneFactory::createRouteBuilder(RoutingAlgorithm::Hierarchical, grid);
+    std::unique_ptr<IRouteBuilder> reference = SceneFactory::createRouteBuilder(RoutingAlgorithm::AStar, grid);
+
+    auto randomObstacle = [&](int lo, int hi) {
+        int x = randomInt(rng, lo, hi) * step;
+        int y = randomInt(rng, lo, hi) * step;
+        return QRect(x, y, randomInt(rng, 1, 10) * step, randomInt(rng, 1, 10) * step);
+    };
+
+    std::vector<QRect> obstacles;
+    for (int i = 0; i < 30; ++i)
+        obstacles.push_back(randomObstacle(0, 60));
+    builder->obstaclesChanged(obstacles, {});
+
+    Result result;
+    for (int edit = 0; edit < 60; ++edit)
+    {
+        // Препятствия и концы маршрутов иногда далеко за картой построителя:
+        // она расширяется, и у кластеров на ее старой границе появляются входы
+        int kind = randomInt(rng, 0, 2);
+        if (kind == 0) {
+            QRect added = randomObstacle(-20, 90);
+            obstacles.push_back(added);
+            builder->obstaclesChanged({ added }, {});
+        } else if (kind == 1 && !obstacles.empty()) {
+            size_t index = static_cast<size_t>(randomInt(rng, 0, static_cast<int>(obstacles.size()) - 1));
+            QRect removed = obstacles[index];
+            obstacles.erase(obstacles.begin() + index);
+            builder->obstaclesChanged({}, { removed });
+        }
+
+        for (int q = 0; q < 4; ++q)
+        {
+            int span = randomInt(rng, 0, 3) == 0 ? 150 : 70;
+            std::pair<QPoint, QPoint> query(
+                QPoint(randomInt(rng, -span / 2, span) * step, randomInt(rng, -span / 2, span) * step),
+                QPoint(randomInt(rng, -span / 2, span) * step, randomInt(rng, -span / 2, span) * step));
+
+            std::vector<QPoint> expected = reference->buildRoute(query.first, query.second, obstacles);
+            const bool reached = reference->lastSearchStats().reached;
+            std::vector<QPoint> path = builder->buildRoute(query.first, query.second, obstacles);
+            ++result.checks;
+
+            QString problem;
+            if (builder->lastSearchStats().reached != reached) {
+                problem = reached ? "no path, A* found one" : "path found, A* found none";
+            } else if (reached) {
+                PathCost pathCost(obstacles, grid, cellExtent(obstacles, { query }, step));
+                if (pathCost.cost(path) < 0)
+                    problem = "path leaves the grid or crosses an obstacle";
+                else if (path.front() != expected.front() || path.back() != expected.back())
+                    problem = "path does not connect the route ends";
+            }
+
+            if (!problem.isEmpty() && ++result.mismatches <= kMaxReported)
+                std::fprintf(stderr, "obstacle updates seed %u edit %d (%d, %d) -> (%d, %d): %s\n", seed, edit,
+                             query.first.x(), query.first.y(), query.second.x(), query.second.y(),
+                             qPrintable(problem));
+        }
+    }
+
+    return result;
+}
+
+}
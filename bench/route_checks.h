@@ -0,0 +1,50 @@
+#ifndef ROUTE_CHECKS_H
+#define ROUTE_CHECKS_H
+
+#include "scene_generators.h"
+#include "grid_settings.h"
+
+// Проверки корректности маршрутизации для режима --verify бенчмарка.
+// Ускоренные построители сравниваются с A* на тех же запросах, взвешенный
+// поиск - с перебором; первые расхождения печатаются в stderr
+namespace RouteChecks {
+
+struct Result {
+    int checks = 0;
+    int mismatches = 0;
+
+    void add(const Result& other)
+    {
+        checks += other.checks;
+        mismatches += other.mismatches;
+    }
+};
+
+// Все построители против A* на запросах сцены: путь находится в тех же случаях,
+// проходит по соседним свободным узлам и стоит столько же (HPA* - только
+// корректность пути: его пути почти кратчайшие). Пакет с общим началом должен
+// давать те же пути, что и одиночные запросы
+Result compareBuilders(const SyntheticScene& scene, const GridSettings& grid);
+
+// То же на мелких случайных сценах с препятствиями не по сетке и концами
+// маршрутов между узлами
+Result compareBuildersOnRandomScenes(quint32 seed, int sceneCount, const GridSettings& grid);
+
+// Взвешенный поиск (случайные stepCost, nearObstacleCost и turnCost) против
+// перебора Дейкстры по состояниям (узел, направление) на мелких случайных сценах;
+// пакетные запросы с общим началом - против одиночных
+Result compareWeighted(quint32 seed, int sceneCount, int cellSize);
+
+// Маршруты сцены после случайных добавлений и удалений препятствий и сдвигов
+// точек совпадают с построенными заново: перестроение не должно пропускать
+// затронутые маршруты, а починка и кэш - выбирать другой из равных путей
+Result checkSceneEdits(quint32 seed, const GridSettings& grid);
+
+// HPA*, которому изменения препятствий приходят уведомлениями, после каждого
+// изменения находит корректные пути в тех же случаях, что и A*, в том числе
+// когда запрос расширяет его карту
+Result checkObstacleUpdates(quint32 seed, int cellSize);
+
+}
+
+#endif // ROUTE_CHECKS_H
@@ -0,0 +1,329 @@
+#include "scene_generators.h"
+#include "route_checks.h"
+#include "scene_factory.h"
+#include "i_scene.h"
+#include "rect_array.h"
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QStringList>
+#include <QThread>
+#include <algorithm>
+#include <cstdio>
+#include <numeric>
+#include <set>
+
+#if defined(Q_OS_WIN)
+#include <windows.h>
+#include <psapi.h>
+#elif defined(Q_OS_UNIX)
+#include <sys/resource.h>
+#endif
+
+namespace {
+
+// Пиковый объём резидентной памяти процесса в КБ (-1, если неизвестен)
+qint64 peakMemoryKb()
+{
+#if defined(Q_OS_WIN)
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return static_cast<qint64>(counters.PeakWorkingSetSize / 1024);
+    return -1;
+#elif defined(Q_OS_UNIX)
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return -1;
+#if defined(Q_OS_MACOS)
+    return usage.ru_maxrss / 1024;
+#else
+    return usage.ru_maxrss;
+#endif
+#else
+    return -1;
+#endif
+}
+
+// Перцентиль по ближайшему рангу, values отсортирован
+double percentile(const std::vector<double>& values, double p)
+{
+    if (values.empty())
+        return 0.0;
+
+    size_t rank = static_cast<size_t>(p / 100.0 * (values.size() - 1) + 0.5);
+    return values[std::min(rank, values.size() - 1)];
+}
+
+QJsonObject distribution(std::vector<double> values)
+{
+    std::sort(values.begin(), values.end());
+    double sum = std::accumulate(values.begin(), values.end(), 0.0);
+
+    QJsonObject obj;
+    obj["mean"] = values.empty() ? 0.0 : sum / values.size();
+    obj["p50"] = percentile(values, 50);
+    obj["p90"] = percentile(values, 90);
+    obj["p99"] = percentile(values, 99);
+    obj["max"] = values.empty() ? 0.0 : values.back();
+    return obj;
+}
+
+// Одиночные запросы к построителю: задержка и число раскрытых узлов
+void measureQueries(const SyntheticScene& scene, RoutingAlgorithm algorithm, const GridSettings& grid,
+                    QJsonObject& record)
+{
+    std::unique_ptr<IRouteBuilder> builder = SceneFactory::createRouteBuilder(algorithm, grid);
+    std::vector<double> latencies;
+    std::vector<double> expanded;
+    latencies.reserve(scene.queries.size());
+    expanded.reserve(scene.queries.size());
+    int reached = 0;
+
+    QElapsedTimer timer;
+    for (const auto& query : scene.queries)
+    {
+        timer.start();
+        builder->buildRoute(query.first, query.second, scene.obstacles);
+        latencies.push_back(timer.nsecsElapsed() / 1000.0);
+
+        SearchStats stats = builder->lastSearchStats();
+        expanded.push_back(stats.nodesExpanded);
+        if (stats.reached)
+            ++reached;
+    }
+
+    // Первый запрос строит сетку препятствий, его считаем отдельно
+    record["first_query_us"] = latencies.empty() ? 0.0 : latencies.front();
+    record["latency_us"] = distribution(latencies);
+    record["nodes_expanded"] = distribution(expanded);
+    record["reached"] = reached;
+}
+
+// Начальное построение маршрутов сцены и их полная перестройка
+void measureRebuild(const SyntheticScene& scene, RoutingAlgorithm algorithm, const GridSettings& grid,
+                    int routeLimit, int threads, QJsonObject& record)
+{
+    std::unique_ptr<IScene> target = SceneFactory::createScene(algorithm, grid);
+    target->setRebuildThreadCount(threads);
+
+    target->addObstacles(scene.obstacles);
+
+    int routeCount = std::min<int>(routeLimit, static_cast<int>(scene.queries.size()));
+    std::vector<std::pair<int, int>> endpoints;
+    endpoints.reserve(routeCount);
+    for (int i = 0; i < routeCount; ++i)
+    {
+        const auto& query = scene.queries[i];
+        endpoints.emplace_back(target->addPoint(query.first), target->addPoint(query.second));
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    for (const auto& ends : endpoints)
+        target->buildRoute(ends.first, ends.second);
+    record["initial_build_ms"] = timer.nsecsElapsed() / 1e6;
+
+    // Точечное препятствие в середине каждого пути затрагивает все маршруты, а
+    // повторный поиск не берется ни из кэша (версия препятствий сменилась), ни
+    // из инкрементального планировщика (концы не двигались): перестроение полное.
+    // Узлы концов маршрутов не перекрываются, чтобы маршруты оставались достижимыми
+    std::set<std::pair<int, int>> ends;
+    for (int id : target->getPointIds())
+    {
+        QPoint pos;
+        target->getPointPosition(id, pos);
+        ends.emplace(pos.x(), pos.y());
+    }
+
+    std::vector<QRect> blockers;
+    for (const Route& route : target->getRouteList())
+    {
+        std::vector<QPoint> path = route.getPath();
+        if (path.size() < 3)
+            continue;
+        const QPoint& mid = path[path.size() / 2];
+        if (!ends.count({mid.x(), mid.y()}))
+            blockers.emplace_back(mid, mid);
+    }
+    target->addObstacles(blockers);
+
+    timer.start();
+    target->rebuildRoutes();
+    record["full_rebuild_ms"] = timer.nsecsElapsed() / 1e6;
+    record["routes"] = routeCount;
+}
+
+bool parseAlgorithm(const QString& name, RoutingAlgorithm& algorithm)
+{
+    if (name == "astar")
+        algorithm = RoutingAlgorithm::AStar;
+    else if (name == "jps")
+        algorithm = RoutingAlgorithm::JumpPoint;
+    else if (name == "jps+")
+        algorithm = RoutingAlgorithm::JumpPointTables;
+    else if (name == "hpa")
+        algorithm = RoutingAlgorithm::Hierarchical;
+    else if (name == "bibfs")
+        algorithm = RoutingAlgorithm::BidirectionalBfs;
+    else if (name == "biastar")
+        algorithm = RoutingAlgorithm::BidirectionalAStar;
+    else
+        return false;
+    return true;
+}
+
+// Режим --verify: вместо замеров сравнивает построители с A* на сгенерированных
+// и мелких случайных сценах, взвешенный поиск - с перебором, а маршруты сцены
+// после правок - с построенными заново. Возвращает false, если найдены расхождения
+bool verify(const std::vector<int>& sizes, int queries, quint32 seed, const GridSettings& grid)
+{
+    RouteChecks::Result total;
+    auto print = [](const char* name, int size, const RouteChecks::Result& result) {
+        std::printf("%-16s %4d  %6d checks  %d mismatches\n", name, size, result.checks, result.mismatches);
+    };
+
+    for (int size : sizes)
+    {
+        for (const SyntheticScene& scene : SceneGenerators::all(size, queries, seed))
+        {
+            RouteChecks::Result result = RouteChecks::compareBuilders(scene, grid);
+            print(qPrintable(scene.name), size, result);
+            total.add(result);
+        }
+    }
+
+    RouteChecks::Result random = RouteChecks::compareBuildersOnRandomScenes(seed, 300, grid);
+    print("random", 20, random);
+    total.add(random);
+
+    RouteChecks::Result edits;
+    for (quint32 i = 0; i < 10; ++i)
+        edits.add(RouteChecks::checkSceneEdits(seed + i, grid));
+    print("scene_edits", 40, edits);
+    total.add(edits);
+
+    RouteChecks::Result updates;
+    for (quint32 i = 0; i < 20; ++i)
+        updates.add(RouteChecks::checkObstacleUpdates(seed + i, grid.cellSize));
+    print("obstacle_updates", 60, updates);
+    total.add(updates);
+
+    RouteChecks::Result weighted = RouteChecks::compareWeighted(seed, 300, grid.cellSize);
+    print("weighted", 20, weighted);
+    total.add(weighted);
+
+    // Правки сцены при неравных стоимостях шагов затрагивают и соседние узлы
+    GridSettings weightedGrid = grid;
+    if (weightedGrid.isUniform()) {
+        weightedGrid.nearObstacleCost = 2;
+        weightedGrid.turnCost = 3;
+    }
+    RouteChecks::Result weightedEdits;
+    for (quint32 i = 0; i < 5; ++i)
+        weightedEdits.add(RouteChecks::checkSceneEdits(seed + i, weightedGrid));
+    print("scene_edits_w", 40, weightedEdits);
+    total.add(weightedEdits);
+
+    std::printf("total: %d checks, %d mismatches\n", total.checks, total.mismatches);
+    return total.mismatches == 0;
+}
+
+std::vector<int> parseSizes(const QString& text)
+{
+    std::vector<int> sizes;
+    for (const QString& part : text.split(',')) {
+        bool ok = false;
+        int size = part.trimmed().toInt(&ok);
+        if (ok && size >= 8)
+            sizes.push_back(size);
+    }
+    return sizes;
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Headless routing benchmark on synthetic scenes");
+    parser.addHelpOption();
+    parser.addOption({ "seed", "Generator seed.", "seed", "1" });
+    parser.addOption({ "sizes", "Comma separated grid sizes in cells.", "sizes", "100,200,400" });
+    parser.addOption({ "queries", "Route queries per scene.", "count", "200" });
+    parser.addOption({ "routes", "Scene routes for the rebuild measurement.", "count", "200" });
+    parser.addOption({ "threads", "Rebuild worker threads.", "count",
+                       QString::number(QThread::idealThreadCount()) });
+    parser.addOption({ "algorithm", "Routing algorithm: astar, bibfs, biastar, jps, jps+ or hpa.", "name", "astar" });
+    parser.addOption({ "cell-size", "Grid cell size in scene units (scenes are generated for 25).", "size", "25" });
+    parser.addOption({ "near-obstacle-cost", "Extra cost of a step into a cell next to an obstacle.", "cost", "0" });
+    parser.addOption({ "turn-cost", "Extra cost of a route turn.", "cost", "0" });
+    parser.addOption({ "output", "Write JSON lines to this file instead of stdout.", "file" });
+    parser.addOption({ "verify", "Check routing results against A* instead of measuring; exit code 1 on mismatches." });
+    parser.process(app);
+
+    quint32 seed = parser.value("seed").toUInt();
+    int queries = std::max(1, parser.value("queries").toInt());
+    int routes = std::max(0, parser.value("routes").toInt());
+    int threads = std::max(1, parser.value("threads").toInt());
+    std::vector<int> sizes = parseSizes(parser.value("sizes"));
+
+    GridSettings grid;
+    grid.cellSize = std::max(1, parser.value("cell-size").toInt());
+    grid.nearObstacleCost = std::max(0, parser.value("near-obstacle-cost").toInt());
+    grid.turnCost = std::max(0, parser.value("turn-cost").toInt());
+
+    if (parser.isSet("verify"))
+        return verify(sizes, queries, seed, grid) ? 0 : 1;
+
+    RoutingAlgorithm algorithm = RoutingAlgorithm::AStar;
+    if (!parseAlgorithm(parser.value("algorithm"), algorithm)) {
+        std::fprintf(stderr, "unknown algorithm %s\n", qPrintable(parser.value("algorithm")));
+        return 1;
+    }
+
+    QFile out;
+    if (parser.isSet("output")) {
+        out.setFileName(parser.value("output"));
+        if (!out.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
+            std::fprintf(stderr, "cannot open %s\n", qPrintable(parser.value("output")));
+            return 1;
+        }
+    } else if (!out.open(stdout, QIODevice::WriteOnly | QIODevice::Text)) {
+        return 1;
+    }
+
+    // По одной JSON-строке на сцену, чтобы результаты удобно сравнивать между прогонами
+    for (int size : sizes)
+    {
+        for (const SyntheticScene& scene : SceneGenerators::all(size, queries, seed))
+        {
+            QJsonObject record;
+            record["scene"] = scene.name;
+            record["size"] = size;
+            record["seed"] = static_cast<qint64>(seed);
+            record["obstacles"] = static_cast<int>(scene.obstacles.size());
+            record["queries"] = static_cast<int>(scene.queries.size());
+            record["threads"] = threads;
+            record["algorithm"] = parser.value("algorithm");
+            record["cell_size"] = grid.cellSize;
+            record["near_obstacle_cost"] = grid.nearObstacleCost;
+            record["turn_cost"] = grid.turnCost;
+            record["simd"] = RectArray::instructionSet();
+
+            measureQueries(scene, algorithm, grid, record);
+            measureRebuild(scene, algorithm, grid, routes, threads, record);
+            record["peak_rss_kb"] = peakMemoryKb();
+
+            out.write(QJsonDocument(record).toJson(QJsonDocument::Compact));
+            out.write("\n");
+            out.flush();
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,269 @@
+#include "scene_generators.h"
+#include <algorithm>
+#include <random>
+
+namespace {
+
+const int kStep = 25;
+
+// Маска занятых узлов сетки, по ней выбираются свободные концы маршрутов
+struct CellMask {
+    int width;
+    int height;
+    std::vector<char> blocked;
+
+    CellMask(int w, int h) : width(w), height(h), blocked(static_cast<size_t>(w) * h, 0) {}
+
+    bool contains(int x, int y) const
+    {
+        return x >= 0 && y >= 0 && x < width && y < height;
+    }
+
+    bool isBlocked(int x, int y) const
+    {
+        return blocked[static_cast<size_t>(y) * width + x] != 0;
+    }
+
+    void set(int x, int y, bool value)
+    {
+        if (contains(x, y))
+            blocked[static_cast<size_t>(y) * width + x] = value ? 1 : 0;
+    }
+
+    void blockRect(int x0, int y0, int x1, int y1)
+    {
+        for (int y = std::max(0, y0); y <= std::min(height - 1, y1); ++y)
+            for (int x = std::max(0, x0); x <= std::min(width - 1, x1); ++x)
+                set(x, y, true);
+    }
+};
+
+// std::uniform_int_distribution зависит от реализации стандартной библиотеки,
+// а сцены должны совпадать на всех платформах
+int uniform(std::mt19937& rng, int lo, int hi)
+{
+    return lo + static_cast<int>(rng() % static_cast<quint32>(hi - lo + 1));
+}
+
+QPoint toWorld(const QPoint& cell)
+{
+    return QPoint(cell.x() * kStep, cell.y() * kStep);
+}
+
+// Прямоугольник, перекрывающий узлы [x0, x1] x [y0, y1] и только их
+QRect cellRect(int x0, int y0, int x1, int y1)
+{
+    return QRect(QPoint(x0 * kStep, y0 * kStep), QPoint(x1 * kStep, y1 * kStep));
+}
+
+// Занятые узлы склеиваем в горизонтальные полосы, чтобы не плодить препятствия
+std::vector<QRect> rowRuns(const CellMask& mask)
+{
+    std::vector<QRect> rects;
+    for (int y = 0; y < mask.height; ++y)
+    {
+        int x = 0;
+        while (x < mask.width)
+        {
+            if (!mask.isBlocked(x, y)) {
+                ++x;
+                continue;
+            }
+
+            int begin = x;
+            while (x < mask.width && mask.isBlocked(x, y))
+                ++x;
+            rects.push_back(cellRect(begin, y, x - 1, y));
+        }
+    }
+    return rects;
+}
+
+QPoint randomFreeCell(const CellMask& mask, std::mt19937& rng, int y0, int y1)
+{
+    for (int attempt = 0; attempt < 10000; ++attempt)
+    {
+        QPoint cell(uniform(rng, 0, mask.width - 1), uniform(rng, y0, y1));
+        if (!mask.isBlocked(cell.x(), cell.y()))
+            return cell;
+    }
+
+    // Почти всё занято — берём первый свободный узел
+    for (int y = y0; y <= y1; ++y)
+        for (int x = 0; x < mask.width; ++x)
+            if (!mask.isBlocked(x, y))
+                return QPoint(x, y);
+    return QPoint(0, y0);
+}
+
+void addQueries(SyntheticScene& scene, const CellMask& mask, int count, std::mt19937& rng,
+                int startRows = -1, int goalRowsFrom = 0)
+{
+    int lastRow = mask.height - 1;
+    if (startRows < 0)
+        startRows = lastRow;
+
+    scene.queries.reserve(scene.queries.size() + count);
+    while (static_cast<int>(scene.queries.size()) < count)
+    {
+        QPoint start = randomFreeCell(mask, rng, 0, startRows);
+        QPoint goal = randomFreeCell(mask, rng, goalRowsFrom, lastRow);
+        if (start == goal)
+            continue;
+        scene.queries.emplace_back(toWorld(start), toWorld(goal));
+    }
+}
+
+SyntheticScene makeScene(const char* name, int sizeCells)
+{
+    SyntheticScene scene;
+    scene.name = name;
+    scene.widthCells = sizeCells;
+    scene.heightCells = sizeCells;
+    return scene;
+}
+
+void scatterRects(CellMask& mask, std::vector<QRect>* rects, double density, std::mt19937& rng)
+{
+    int maxSide = std::max(2, mask.width / 20);
+    long long target = static_cast<long long>(density * mask.width * mask.height);
+    long long covered = 0;
+
+    while (covered < target)
+    {
+        int w = uniform(rng, 1, maxSide);
+        int h = uniform(rng, 1, maxSide);
+        int x = uniform(rng, 0, mask.width - w);
+        int y = uniform(rng, 0, mask.height - h);
+
+        mask.blockRect(x, y, x + w - 1, y + h - 1);
+        if (rects)
+            rects->push_back(cellRect(x, y, x + w - 1, y + h - 1));
+        covered += static_cast<long long>(w) * h;
+    }
+}
+
+}
+
+namespace SceneGenerators {
+
+SyntheticScene randomRects(int sizeCells, int queryCount, double density, quint32 seed)
+{
+    std::mt19937 rng(seed);
+    SyntheticScene scene = makeScene("random_rects", sizeCells);
+    CellMask mask(sizeCells, sizeCells);
+
+    // Прямоугольники оставляем как есть, с перекрытиями, как их рисует пользователь
+    scatterRects(mask, &scene.obstacles, density, rng);
+    addQueries(scene, mask, queryCount, rng);
+    return scene;
+}
+
+SyntheticScene maze(int sizeCells, int queryCount, quint32 seed)
+{
+    std::mt19937 rng(seed);
+    SyntheticScene scene = makeScene("maze", sizeCells);
+    CellMask mask(sizeCells, sizeCells);
+    std::fill(mask.blocked.begin(), mask.blocked.end(), 1);
+
+    // Комнаты в нечётных узлах, стены между ними пробиваются обходом в глубину
+    int rooms = std::max(1, (sizeCells - 1) / 2);
+    std::vector<char> visited(static_cast<size_t>(rooms) * rooms, 0);
+    std::vector<QPoint> stack;
+    stack.push_back(QPoint(0, 0));
+    visited[0] = 1;
+    mask.set(1, 1, false);
+
+    const QPoint dirs[4] = { QPoint(1, 0), QPoint(-1, 0), QPoint(0, 1), QPoint(0, -1) };
+    while (!stack.empty())
+    {
+        QPoint room = stack.back();
+
+        QPoint options[4];
+        int optionCount = 0;
+        for (const QPoint& d : dirs)
+        {
+            QPoint next = room + d;
+            if (next.x() < 0 || next.y() < 0 || next.x() >= rooms || next.y() >= rooms)
+                continue;
+            if (!visited[static_cast<size_t>(next.y()) * rooms + next.x()])
+                options[optionCount++] = next;
+        }
+
+        if (optionCount == 0) {
+            stack.pop_back();
+            continue;
+        }
+
+        QPoint next = options[uniform(rng, 0, optionCount - 1)];
+        visited[static_cast<size_t>(next.y()) * rooms + next.x()] = 1;
+        mask.set(room.x() + next.x() + 1, room.y() + next.y() + 1, false);
+        mask.set(2 * next.x() + 1, 2 * next.y() + 1, false);
+        stack.push_back(next);
+    }
+
+    scene.obstacles = rowRuns(mask);
+    addQueries(scene, mask, queryCount, rng);
+    return scene;
+}
+
+SyntheticScene corridors(int sizeCells, int queryCount, quint32 seed)
+{
+    std::mt19937 rng(seed);
+    SyntheticScene scene = makeScene("corridors", sizeCells);
+    CellMask mask(sizeCells, sizeCells);
+
+    // Стена через каждые четыре ряда с одним проходом
+    for (int y = 3; y < sizeCells - 1; y += 4)
+    {
+        mask.blockRect(0, y, sizeCells - 1, y);
+        mask.set(uniform(rng, 0, sizeCells - 1), y, false);
+    }
+
+    scene.obstacles = rowRuns(mask);
+
+    // Старт сверху, цель снизу: маршрут проходит через все коридоры
+    addQueries(scene, mask, queryCount, rng, sizeCells / 4, sizeCells - sizeCells / 4);
+    return scene;
+}
+
+SyntheticScene enclosedGoals(int sizeCells, int queryCount, quint32 seed)
+{
+    std::mt19937 rng(seed);
+    SyntheticScene scene = makeScene("enclosed_goals", sizeCells);
+    CellMask mask(sizeCells, sizeCells);
+    scatterRects(mask, nullptr, 0.1, rng);
+
+    // Сначала замуровываем все цели, потом выбираем свободные старты
+    std::vector<QPoint> goals;
+    goals.reserve(queryCount);
+    for (int i = 0; i < queryCount; ++i)
+    {
+        QPoint goal(uniform(rng, 2, sizeCells - 3), uniform(rng, 2, sizeCells - 3));
+        mask.blockRect(goal.x() - 1, goal.y() - 1, goal.x() + 1, goal.y() + 1);
+        mask.set(goal.x(), goal.y(), false);
+        goals.push_back(goal);
+    }
+
+    scene.obstacles = rowRuns(mask);
+
+    scene.queries.reserve(queryCount);
+    for (const QPoint& goal : goals)
+    {
+        QPoint start = randomFreeCell(mask, rng, 0, sizeCells - 1);
+        scene.queries.emplace_back(toWorld(start), toWorld(goal));
+    }
+    return scene;
+}
+
+std::vector<SyntheticScene> all(int sizeCells, int queryCount, quint32 seed)
+{
+    std::vector<SyntheticScene> scenes;
+    scenes.push_back(randomRects(sizeCells, queryCount, 0.2, seed));
+    scenes.push_back(maze(sizeCells, queryCount, seed));
+    scenes.push_back(corridors(sizeCells, queryCount, seed));
+    scenes.push_back(enclosedGoals(sizeCells, queryCount, seed));
+    return scenes;
+}
+
+}
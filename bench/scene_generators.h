@@ -0,0 +1,39 @@
+#ifndef SCENE_GENERATORS_H
+#define SCENE_GENERATORS_H
+
+#include <QPoint>
+#include <QRect>
+#include <QString>
+#include <QtGlobal>
+#include <utility>
+#include <vector>
+
+// Синтетическая сцена для бенчмарка: препятствия и пары концов маршрутов
+struct SyntheticScene {
+    QString name;
+    int widthCells = 0;
+    int heightCells = 0;
+    std::vector<QRect> obstacles;
+    std::vector<std::pair<QPoint, QPoint>> queries;
+};
+
+// Генераторы детерминированы: одинаковые параметры и seed дают одинаковую сцену
+namespace SceneGenerators {
+
+// Случайные перекрывающиеся прямоугольники, занимающие около density площади
+SyntheticScene randomRects(int sizeCells, int queryCount, double density, quint32 seed);
+
+// Лабиринт (обход в глубину): длинные извилистые пути с единственным решением
+SyntheticScene maze(int sizeCells, int queryCount, quint32 seed);
+
+// Горизонтальные стены с редкими проходами: маршрут петляет по коридорам
+SyntheticScene corridors(int sizeCells, int queryCount, quint32 seed);
+
+// Цель замурована: поиск обходит всю доступную область и не находит пути
+SyntheticScene enclosedGoals(int sizeCells, int queryCount, quint32 seed);
+
+std::vector<SyntheticScene> all(int sizeCells, int queryCount, quint32 seed);
+
+}
+
+#endif // SCENE_GENERATORS_H
@@ -0,0 +1,54 @@
+#ifndef ASYNC_ROUTE_PLANNER_H
+#define ASYNC_ROUTE_PLANNER_H
+
+#include "i_route_builder.h"
+#include <QObject>
+#include <QThreadPool>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <vector>
+
+// Фоновое построение маршрутов. Каждое задание получает номер поколения;
+// новое задание отменяет все предыдущие, а результат доставляется в поток,
+// создавший планировщик, только если его поколение все еще последнее.
+class AsyncRoutePlanner {
+public:
+    struct Job {
+        std::vector<int> routeIds;
+        std::vector<RouteEndpoints> endpoints;
+        std::vector<QRect> obstacles;
+        quint64 obstaclesVersion = 0;
+    };
+
+    struct Result {
+        quint64 generation = 0;
+        std::vector<int> routeIds;
+        std::vector<RouteEndpoints> endpoints;
+        quint64 obstaclesVersion = 0;
+        std::vector<std::vector<QPoint>> paths;
+    };
+
+    using ResultHandler = std::function<void(const Result&)>;
+
+    AsyncRoutePlanner(std::unique_ptr<IRouteBuilder> builder, ResultHandler handler);
+    ~AsyncRoutePlanner();
+
+    // Ставит задание в очередь, отменяя незавершенные; возвращает его поколение
+    quint64 submit(Job job);
+
+    // Отменяет все незавершенные задания
+    void cancel();
+
+private:
+    void run(quint64 generation, const Job& job);
+    bool isStale(quint64 generation) const;
+
+    std::unique_ptr<IRouteBuilder> m_builder;
+    ResultHandler m_handler;
+    std::atomic<quint64> m_generation;
+    QObject m_context;
+    QThreadPool m_pool;
+};
+
+#endif // ASYNC_ROUTE_PLANNER_H
@@ -0,0 +1,36 @@
+#ifndef BUCKET_QUEUE_H
+#define BUCKET_QUEUE_H
+
+#include <vector>
+
+// Монотонная очередь с приоритетом для целых ключей (bucket queue): извлекаемые
+// ключи не убывают, а новый ключ не меньше последнего извлеченного (или первого
+// добавленного) и больше его не более чем на span. Этому условию удовлетворяет
+// A* с согласованной эвристикой и целыми стоимостями шагов. Элементы лежат
+// в кольце из span + 1 корзин, вставка и извлечение - O(1) без перестройки кучи.
+//
+// Корзины только растут, поэтому после первых запросов очередь не выделяет память.
+class BucketQueue {
+public:
+    BucketQueue();
+
+    // Очищает очередь для ключей с разбросом не больше span
+    void reset(int span);
+
+    void push(int key, int value);
+    bool empty() const;
+    int size() const;
+
+    // Извлекает элемент с наименьшим ключом из непустой очереди; из равных -
+    // добавленный последним
+    int pop(int& key);
+
+private:
+    std::vector<std::vector<int>> m_buckets;
+    int m_bucketCount;
+    int m_current;
+    int m_size;
+    bool m_anchored;
+};
+
+#endif // BUCKET_QUEUE_H
@@ -2,22 +2,55 @@
 #define ELEMENT_MANAGER_H
 
 #include "i_element_manager.h"
-#include <map>
+#include <QtGlobal>
 
+// Точки и препятствия хранятся в отдельных плотных массивах (структура массивов).
+// Идентификатор элемента - стабильный дескриптор: таблица по идентификатору
+// указывает на позицию элемента в его массиве, удаление - перестановка
+// с последним элементом за O(1).
 class ElementManager : public IElementManager {
 public:
     ElementManager();
     
-    void addElement(std::unique_ptr<IElement> element) override;
-    void removeElement(int id) override;
-    IElement* getElement(int id) override;
-    const std::vector<std::unique_ptr<IElement>>& getAllElements() const override;
-    std::vector<IElement*> getAllElementsPtr() override;
+    void addPoint(int id, const QPoint& position) override;
+    bool setPointPosition(int id, const QPoint& position) override;
+    bool getPointPosition(int id, QPoint& position) const override;
+    const std::vector<int>& getPointIds() const override;
+    const std::vector<QPoint>& getPointPositions() const override;
+    void addPoints(int firstId, const std::vector<QPoint>& positions) override;
+    
+    void addObstacle(int id, const QRect& bounds) override;
+    bool getObstacleBounds(int id, QRect& bounds) const override;
+    const std::vector<int>& getObstacleIds() const override;
+    const std::vector<QRect>& getObstacleBounds() const override;
+    void addObstacles(int firstId, const std::vector<QRect>& bounds) override;
+    
+    bool removeElement(int id) override;
+    bool contains(int id) const override;
 
 private:
-    std::vector<std::unique_ptr<IElement>> m_elements;
-    std::map<int, IElement*> m_elementMap;
-    int m_nextId;
+    enum class Kind : quint8 {
+        None,
+        Point,
+        Obstacle
+    };
+    
+    struct Slot {
+        Kind kind = Kind::None;
+        int index = -1;
+    };
+    
+    const Slot* findSlot(int id) const;
+    Slot& allocateSlot(int id, Kind kind);
+    void reserveSlots(int firstId, size_t count);
+    
+    std::vector<Slot> m_slots;
+    
+    std::vector<int> m_pointIds;
+    std::vector<QPoint> m_pointPositions;
+    
+    std::vector<int> m_obstacleIds;
+    std::vector<QRect> m_obstacleBounds;
 };
 
-#endif // ELEMENT_MANAGER_H
\ No newline at end of file
+#endif // ELEMENT_MANAGER_H
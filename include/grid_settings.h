@@ -0,0 +1,23 @@
+#ifndef GRID_SETTINGS_H
+#define GRID_SETTINGS_H
+
+// Параметры сетки маршрутизации сцены: одни и те же у сцены, построителей
+// маршрутов и отображения. Задаются при создании сцены через фабрику.
+struct GridSettings {
+    // Шаг сетки в мировых координатах
+    int cellSize = 25;
+
+    // Стоимость шага в соседний узел; узлы рядом с препятствием (в том числе
+    // по диагонали) дороже на nearObstacleCost, каждый поворот пути - на turnCost
+    int stepCost = 1;
+    int nearObstacleCost = 0;
+    int turnCost = 0;
+
+    // Все шаги равноценны: кратчайший путь - путь с наименьшим числом узлов
+    bool isUniform() const
+    {
+        return nearObstacleCost == 0 && turnCost == 0;
+    }
+};
+
+#endif // GRID_SETTINGS_H
@@ -3,10 +3,14 @@
 
 #include <QWidget>
 #include <QPoint>
+#include <QPixmap>
+#include <QTimer>
 #include <vector>
 #include <memory>
 #include "i_scene.h"
 
+class QPainter;
+
 class GridView : public QWidget {
     Q_OBJECT
 public:
@@ -20,8 +24,17 @@ protected:
     void keyPressEvent(QKeyEvent *) override;
     void wheelEvent(QWheelEvent *) override;
     QPoint screenToWorld(const QPoint &p);
+    QRect worldToScreen(const QRect &r) const;
 
 private:
+    // Статический слой (сетка и препятствия) кешируется в QPixmap и
+    // перерисовывается только при изменении препятствий, масштаба или размера
+    bool isStaticLayerValid() const;
+    void renderStaticLayer();
+    QRect obstaclePreviewRect() const;
+    QRect statsOverlayRect() const;
+    void drawStatsOverlay(QPainter &p, const RoutingStats::Snapshot &stats);
+
     std::unique_ptr<IScene> m_scene;
     int m_selectedPoint = -1;
     int m_dragPoint = -1;
@@ -32,6 +45,18 @@ private:
     bool m_creatingObstacle = false;
     QPoint m_obstacleStart;
     QPoint m_obstacleEnd;
+    
+    QPixmap m_staticLayer;
+    double m_staticLayerScale = 0.0;
+    quint64 m_staticLayerVersion = 0;
+    
+    // Оверлей статистики маршрутизации (F3): время кадра и число
+    // перестроенных маршрутов между кадрами
+    bool m_showStats = false;
+    QTimer m_statsTimer;
+    double m_frameTimeMs = 0.0;
+    quint64 m_frameReplans = 0;
+    quint64 m_replansSeen = 0;
 };
 
 #endif // GRID_VIEW_H
@@ -0,0 +1,122 @@
+#ifndef HIERARCHICAL_ROUTE_BUILDER_H
+#define HIERARCHICAL_ROUTE_BUILDER_H
+
+#include "i_route_builder.h"
+#include "occupancy_grid.h"
+#include "search_workspace.h"
+#include <unordered_map>
+
+// Иерархический поиск (HPA*) для больших сцен. Сетка делится на квадратные
+// кластеры; на общих границах соседних кластеров выбираются узлы входов,
+// а внутри кластера запоминаются расстояния между его входами. Маршрут ищется
+// по графу входов, затем каждый его отрезок уточняется поиском внутри кластера.
+//
+// Кластеры привязаны к решетке, кратной clusterSize узлов от начала координат.
+// Данные кластера считаются лениво, при первом обращении, и сбрасываются только
+// для кластеров рядом с добавленными или удаленными препятствиями, а при
+// расширении карты - для кластеров на расширенной стороне ее старой границы.
+// Изменения препятствий построитель получает через obstaclesChanged(); без
+// уведомлений он сверяет набор препятствий каждого запроса с прежним. Время запроса
+// растет с длиной маршрута в кластерах, а не с площадью сцены. Пути почти
+// кратчайшие: отклонение появляется только из-за выбора узлов на границах.
+class HierarchicalRouteBuilder : public IRouteBuilder {
+public:
+    // clusterSize - сторона кластера в узлах, cellSize - шаг сетки в мировых координатах
+    HierarchicalRouteBuilder(int clusterSize, int cellSize);
+
+    std::vector<QPoint> buildRoute(
+        const QPoint& start,
+        const QPoint& end,
+        const std::vector<QRect>& obstacles
+    ) override;
+    std::vector<std::vector<QPoint>> buildRoutes(
+        const std::vector<RouteEndpoints>& endpoints,
+        const std::vector<QRect>& obstacles
+    ) override;
+    void obstaclesChanged(const std::vector<QRect>& added, const std::vector<QRect>& removed) override;
+    std::unique_ptr<IRouteBuilder> clone() const override;
+    SearchStats lastSearchStats() const override;
+
+private:
+    // Переход через границу: узел в кластере-владельце и соседний узел за границей
+    using Transition = std::pair<QPoint, QPoint>;
+
+    struct Cluster {
+        std::vector<QPoint> nodes;
+        // Для каждого узла - узлы соседних кластеров, связанные с ним переходом
+        std::vector<std::vector<QPoint>> links;
+        // Расстояния между узлами внутри кластера (nodes.size() x nodes.size()), -1 - пути нет
+        std::vector<int> distances;
+        std::unordered_map<quint64, int> nodeIndex;
+    };
+
+    struct OpenNode {
+        int f;
+        int g;
+        quint64 key;
+    };
+
+    struct NodeState {
+        int g;
+        quint64 parent;
+    };
+
+    std::vector<QPoint> buildRouteInternal(
+        const QPoint& a,
+        const QPoint& b,
+        const std::vector<QRect>& obstacles,
+        int maxOffsetMultiplier = 5
+    );
+
+    // Приводит карту и кэш кластеров в соответствие с набором препятствий
+    void syncObstacles(const std::vector<QRect>& obstacles, int step, const QRect& bounds);
+    void invalidateClusters(const QRect& cellArea);
+    // Кластеры, входы которых меняет препятствие
+    void invalidateAround(const QRect& obstacle, int step);
+    // Кластеры старой границы карты, за которой при расширении появились узлы
+    void invalidateBorders(const QRect& before, const QRect& after);
+    void clearClusters();
+
+    QPoint clusterOf(const QPoint& cell) const;
+    QRect clusterCells(const QPoint& cluster) const;
+    bool isFree(int gx, int gy) const;
+
+    // Переходы через правую (vertical) или нижнюю границу кластера
+    const std::vector<Transition>& border(const QPoint& cluster, bool vertical);
+    const Cluster& cluster(const QPoint& coord);
+
+    // Поиск в ширину внутри кластера от узла from
+    void searchInCluster(const QPoint& clusterCoord, const QPoint& from);
+    int localDistance(const QPoint& cell) const;
+    void appendLocalPath(const QPoint& from, const QPoint& to, std::vector<QPoint>& cells);
+
+    static quint64 key(int x, int y);
+    static quint64 key(const QPoint& p);
+    static QPoint fromKey(quint64 k);
+
+    int m_clusterSize;
+    int m_cellSize;
+    OccupancyGrid m_grid;
+    // Набор препятствий известен по уведомлениям; после уведомления карту
+    // нужно построить заново по препятствиям следующего запроса
+    bool m_tracksObstacles;
+    bool m_gridStale;
+    // Область узлов под препятствиями отслеживаемого набора; после удаления
+    // препятствия она может сжаться и пересчитывается при следующем запросе
+    QRect m_blockedExtent;
+    bool m_blockedExtentStale;
+    std::unordered_map<quint64, Cluster> m_clusters;
+    std::unordered_map<quint64, std::vector<Transition>> m_borders[2];
+
+    // Рабочая память поиска внутри кластера
+    QRect m_localArea;
+    SearchWorkspace m_localWorkspace;
+
+    // Рабочие массивы поиска по графу входов
+    std::unordered_map<quint64, NodeState> m_states;
+    std::vector<OpenNode> m_open;
+
+    SearchStats m_stats;
+};
+
+#endif // HIERARCHICAL_ROUTE_BUILDER_H
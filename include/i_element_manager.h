@@ -2,18 +2,33 @@
 #define I_ELEMENT_MANAGER_H
 
 #include <vector>
-#include <memory>
-#include "i_element.h"
+#include <QPoint>
+#include <QRect>
 
 class IElementManager {
 public:
     virtual ~IElementManager() = default;
     
-    virtual void addElement(std::unique_ptr<IElement> element) = 0;
-    virtual void removeElement(int id) = 0;
-    virtual IElement* getElement(int id) = 0;
-    virtual const std::vector<std::unique_ptr<IElement>>& getAllElements() const = 0;
-    virtual std::vector<IElement*> getAllElementsPtr() = 0;
+    // Точки
+    virtual void addPoint(int id, const QPoint& position) = 0;
+    virtual bool setPointPosition(int id, const QPoint& position) = 0;
+    virtual bool getPointPosition(int id, QPoint& position) const = 0;
+    virtual const std::vector<int>& getPointIds() const = 0;
+    virtual const std::vector<QPoint>& getPointPositions() const = 0;
+    
+    // Пакетное добавление: элементы получают идентификаторы firstId, firstId + 1, ...
+    virtual void addPoints(int firstId, const std::vector<QPoint>& positions) = 0;
+    
+    // Препятствия
+    virtual void addObstacle(int id, const QRect& bounds) = 0;
+    virtual bool getObstacleBounds(int id, QRect& bounds) const = 0;
+    virtual const std::vector<int>& getObstacleIds() const = 0;
+    virtual const std::vector<QRect>& getObstacleBounds() const = 0;
+    virtual void addObstacles(int firstId, const std::vector<QRect>& bounds) = 0;
+    
+    // Общие операции
+    virtual bool removeElement(int id) = 0;
+    virtual bool contains(int id) const = 0;
 };
 
-#endif // I_ELEMENT_MANAGER_H
\ No newline at end of file
+#endif // I_ELEMENT_MANAGER_H
@@ -5,6 +5,14 @@
 #include <QPoint>
 #include <QRect>
 #include <memory>
+#include "route_batch.h"
+
+// Статистика последнего поиска маршрута
+struct SearchStats {
+    int nodesExpanded = 0;
+    int openListPeak = 0;
+    bool reached = false;
+};
 
 class IRouteBuilder {
 public:
@@ -15,6 +23,27 @@ public:
         const QPoint& end, 
         const std::vector<QRect>& obstacles
     ) = 0;
+    
+    // Пакетное построение: результат i соответствует endpoints[i].
+    // Маршруты с общим стартом извлекаются из одного дерева поиска;
+    // пути те же, что у buildRoute для каждого маршрута по отдельности.
+    virtual std::vector<std::vector<QPoint>> buildRoutes(
+        const std::vector<RouteEndpoints>& endpoints,
+        const std::vector<QRect>& obstacles
+    ) = 0;
+    
+    // Набор препятствий следующих запросов отличается от прежнего добавленными
+    // и удаленными препятствиями. Построитель, данные которого зависят от
+    // препятствий (HPA*), обновляет по спискам только затронутые части, а пока
+    // изменений нет, не сравнивает наборы в каждом запросе. Без уведомлений
+    // построитель сверяет набор запроса с прежним сам
+    virtual void obstaclesChanged(const std::vector<QRect>& /*added*/, const std::vector<QRect>& /*removed*/) {}
+    
+    // Новый построитель того же типа с собственными рабочими буферами
+    // (для параллельного построения маршрутов)
+    virtual std::unique_ptr<IRouteBuilder> clone() const = 0;
+    
+    virtual SearchStats lastSearchStats() const = 0;
 };
 
 #endif // I_ROUTE_BUILDER_H
\ No newline at end of file
@@ -4,8 +4,13 @@
 #include <vector>
 #include <QPoint>
 #include <QRect>
+#include <functional>
 #include <memory>
-#include "i_element.h"
+#include "grid_settings.h"
+#include "route.h"
+#include "route_paths.h"
+#include "route_cache.h"
+#include "routing_stats.h"
 
 class IScene {
 public:
@@ -13,24 +18,72 @@ public:
     
     // Управление элементами
     virtual int addPoint(const QPoint& position) = 0;
-    virtual void addObstacle(const QRect& bounds) = 0;
+    virtual int addObstacle(const QRect& bounds) = 0;
     virtual void removeElement(int id) = 0;
+    virtual bool movePoint(int id, const QPoint& position) = 0;
     
-    // Получение элементов
-    virtual IElement* getElement(int id) = 0;
-    virtual const std::vector<std::unique_ptr<IElement>>& getAllElements() const = 0;
-    virtual std::vector<IElement*> getAllElementsPtr() = 0;
+    // Пакетное добавление: идентификаторы выдаются подряд, возвращается первый
+    virtual int addPoints(const std::vector<QPoint>& positions) = 0;
+    virtual int addObstacles(const std::vector<QRect>& bounds) = 0;
+    
+    // Пакет изменений: перестроение маршрутов и смена версии препятствий
+    // откладываются до commitBatch, который перестраивает затронутые маршруты
+    // за один проход. Пакеты могут быть вложенными; применяется внешний
+    virtual void beginBatch() = 0;
+    virtual void commitBatch() = 0;
+    
+    // Получение точек
+    virtual bool getPointPosition(int id, QPoint& position) const = 0;
+    virtual const std::vector<int>& getPointIds() const = 0;
+    virtual const std::vector<QPoint>& getPointPositions() const = 0;
+    
+    // Точка не дальше radius от worldPos (ближайшая); -1, если такой нет
+    virtual int pickPoint(const QPoint& worldPos, int radius) const = 0;
     
     // Работа с препятствиями
     virtual const std::vector<QRect>& getObstacles() const = 0;
+    virtual quint64 getObstaclesVersion() const = 0;
     
     // Работа с маршрутами
     virtual bool buildRoute(int startId, int endId) = 0;
-    virtual const std::vector<std::vector<QPoint>>& getRoutes() const = 0;
+    virtual const RoutePaths& getRoutes() const = 0;
+    virtual const std::vector<Route>& getRouteList() const = 0;
+    
+    // Маршрут с уже известным путем (например, сохраненным в файле) - без поиска.
+    // Пустой путь - недостижимый маршрут, как после перестроения
+    virtual bool addRoute(int startId, int endId, const std::vector<QPoint>& path) = 0;
+    
+    // Пакет маршрутов с известными путями: концы маршрута i - endpointIds[2i] и
+    // endpointIds[2i + 1], путь - pathPoints[pathOffsets[i]..pathOffsets[i + 1]).
+    // Маршруты с несуществующими концами пропускаются; возвращает число добавленных
+    virtual size_t addRoutes(const std::vector<int>& endpointIds, const std::vector<QPoint>& pathPoints,
+                             const std::vector<quint64>& pathOffsets) = 0;
+    
     virtual void removeRoutesWithPoint(int pointId) = 0;
     virtual void rebuildRoutes() = 0;
+    virtual void setRebuildThreadCount(int count) = 0;
+    
+    // Попадания и промахи кэша построенных маршрутов
+    virtual RouteCache::Stats getRouteCacheStats() const = 0;
+    
+    // Счетчики поисков и перестроений маршрутов (сборка с GRIDVIEW_ENABLE_STATS);
+    // без нее снимок пустой, а Snapshot::enabled равно false
+    virtual RoutingStats::Snapshot getRoutingStats() const = 0;
+    virtual void resetRoutingStats() = 0;
+    
+    // Асинхронное перестроение маршрутов: результат применяется в потоке сцены,
+    // после чего вызывается обработчик. Маршруты с перемещенными концами
+    // чинятся сразу инкрементальным планировщиком, в фоне ищутся остальные
+    virtual void requestRouteRebuild() = 0;
+    virtual void setRoutesUpdatedHandler(std::function<void()> handler) = 0;
+    
+    // Возвращает и сбрасывает область сцены, в которой изменились маршруты
+    virtual QRect takeDirtyRect() = 0;
     
     // Вспомогательные функции
+    
+    // Параметры сетки маршрутизации, заданные при создании сцены
+    virtual const GridSettings& getGridSettings() const = 0;
     virtual QPoint snapToGrid(const QPoint& p) const = 0;
     virtual bool isInsideBlockedCell(const QPoint& pt) const = 0;
 };
@@ -0,0 +1,63 @@
+#ifndef INCREMENTAL_PLANNER_H
+#define INCREMENTAL_PLANNER_H
+
+#include "occupancy_grid.h"
+#include <vector>
+#include <QPoint>
+#include <QRect>
+
+// Инкрементальный планировщик маршрута (LPA* с нулевой эвристикой).
+// Дерево поиска строится от неподвижного конца маршрута и переиспользуется
+// между вызовами: при перемещении другого конца или изменении препятствий
+// пересчитываются только затронутые узлы. Все шаги равноценны, поэтому
+// планировщик подходит только для сетки с GridSettings::isUniform().
+// Из равных по длине путей выбирается тот же, что у RouteBuilder, каким бы
+// концом ни был корень дерева.
+class IncrementalPlanner {
+public:
+    // step - шаг сетки в мировых координатах
+    explicit IncrementalPlanner(int step);
+
+    // Возвращает false, если планировщик не может обслужить запрос
+    // (например, начальный узел заблокирован) и нужен обычный поиск
+    bool plan(const QPoint& start,
+              const QPoint& end,
+              const std::vector<QRect>& obstacles,
+              std::vector<QPoint>& path);
+
+private:
+    struct QueueEntry {
+        int key;
+        int index;
+    };
+
+    void reset(const QPoint& rootCell, const std::vector<QRect>& obstacles, const QRect& extent);
+    void applyObstacleChanges(const std::vector<QRect>& obstacles);
+    void updateVertex(int index);
+    void computeShortestPath(int targetIndex);
+    void markShortestPaths(int startIndex);
+    bool isCloserToStart(int index, int from, bool forward) const;
+    int neighbors(int index, int* out) const;
+    int key(int index) const;
+    void push(int index);
+    bool isPassable(int index) const;
+    static bool laterEntry(const QueueEntry& lhs, const QueueEntry& rhs);
+
+    OccupancyGrid m_grid;
+    std::vector<int> m_g;
+    std::vector<int> m_rhs;
+    std::vector<QueueEntry> m_queue;
+    int m_step;
+    QPoint m_rootCell;
+    int m_rootIndex;
+    QPoint m_lastStartCell;
+    QPoint m_lastEndCell;
+    bool m_valid;
+
+    // Узлы кратчайших путей от начала при дереве от конца маршрута
+    std::vector<quint32> m_marks;
+    std::vector<int> m_pending;
+    quint32 m_markStamp;
+};
+
+#endif // INCREMENTAL_PLANNER_H
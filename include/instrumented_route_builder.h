@@ -0,0 +1,33 @@
+#ifndef INSTRUMENTED_ROUTE_BUILDER_H
+#define INSTRUMENTED_ROUTE_BUILDER_H
+
+#include "i_route_builder.h"
+#include "routing_stats.h"
+
+// Обертка построителя: передает запросы вложенному построителю и записывает
+// их статистику и длительность в RoutingStats. Копии из clone() пишут в тот же
+// RoutingStats, поэтому учитываются и параллельные, и фоновые поиски.
+// RoutingStats должен пережить все копии.
+class InstrumentedRouteBuilder : public IRouteBuilder {
+public:
+    InstrumentedRouteBuilder(std::unique_ptr<IRouteBuilder> builder, RoutingStats* stats);
+
+    std::vector<QPoint> buildRoute(
+        const QPoint& start,
+        const QPoint& end,
+        const std::vector<QRect>& obstacles
+    ) override;
+    std::vector<std::vector<QPoint>> buildRoutes(
+        const std::vector<RouteEndpoints>& endpoints,
+        const std::vector<QRect>& obstacles
+    ) override;
+    void obstaclesChanged(const std::vector<QRect>& added, const std::vector<QRect>& removed) override;
+    std::unique_ptr<IRouteBuilder> clone() const override;
+    SearchStats lastSearchStats() const override;
+
+private:
+    std::unique_ptr<IRouteBuilder> m_builder;
+    RoutingStats* m_stats;
+};
+
+#endif // INSTRUMENTED_ROUTE_BUILDER_H
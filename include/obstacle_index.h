@@ -0,0 +1,51 @@
+#ifndef OBSTACLE_INDEX_H
+#define OBSTACLE_INDEX_H
+
+#include "rect_array.h"
+#include <vector>
+#include <unordered_map>
+#include <QPoint>
+#include <QRect>
+#include <QtGlobal>
+
+// Пространственный индекс препятствий: равномерная сетка корзин.
+// Каждое препятствие регистрируется во всех корзинах, которые оно покрывает,
+// поэтому проверка точки сводится к просмотру одной корзины.
+// Очень большие препятствия хранятся отдельным списком, чтобы не раздувать корзины.
+// Границы лежат в RectArray, поэтому список больших препятствий и полный перебор
+// при запросе большой области проверяются блоками SIMD.
+class ObstacleIndex {
+public:
+    explicit ObstacleIndex(int bucketSize);
+
+    void insert(int id, const QRect& bounds);
+    void remove(int id);
+    void clear();
+    void reserve(size_t count);
+
+    bool contains(int id) const;
+    QRect bounds(int id) const;
+    size_t size() const;
+
+    // Лежит ли точка внутри какого-либо препятствия
+    bool containsPoint(const QPoint& pt) const;
+
+    // Идентификаторы препятствий, пересекающих область
+    std::vector<int> query(const QRect& area) const;
+
+private:
+    QRect bucketRange(const QRect& bounds) const;
+    int bucketOf(int coord) const;
+    static quint64 bucketKey(int bx, int by);
+
+    int m_bucketSize;
+    // Границы всех препятствий; m_ids[i] - идентификатор прямоугольника m_rects.at(i)
+    RectArray m_rects;
+    std::vector<int> m_ids;
+    std::unordered_map<int, size_t> m_slots;
+    std::unordered_map<quint64, std::vector<int>> m_buckets;
+    RectArray m_largeRects;
+    std::vector<int> m_largeIds;
+};
+
+#endif // OBSTACLE_INDEX_H
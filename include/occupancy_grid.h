@@ -0,0 +1,74 @@
+#ifndef OCCUPANCY_GRID_H
+#define OCCUPANCY_GRID_H
+
+#include <vector>
+#include <QPoint>
+#include <QRect>
+#include <QtGlobal>
+
+// Битовая карта занятости узлов сетки в ограниченной области.
+// Строится один раз для набора препятствий и переиспользуется между запросами.
+class OccupancyGrid {
+public:
+    OccupancyGrid();
+
+    // Проверяет, построена ли карта для данного набора препятствий
+    // и покрывает ли она область (в координатах сетки)
+    bool isValidFor(const std::vector<QRect>& obstacles, int step, const QRect& cellArea) const;
+
+    // Строит карту в заданной области (в координатах сетки)
+    void build(const std::vector<QRect>& obstacles, int step, const QRect& cellExtent);
+
+    // Перестраивает карту, если она не годится для запроса; при тех же препятствиях
+    // область только расширяется. Возвращает true, если карта перестроена
+    bool ensure(const std::vector<QRect>& obstacles, int step, const QRect& cellArea);
+
+    // Минимальная область, в которой кратчайший путь между узлами
+    // совпадает с путем на бесконечной сетке
+    static QRect requiredExtent(const std::vector<QRect>& obstacles, int step,
+                                const QPoint& startCell, const QPoint& goalCell, int margin);
+    // То же по заранее посчитанной области blockedExtent() препятствий
+    static QRect requiredExtent(const QRect& blocked, const QPoint& startCell, const QPoint& goalCell, int margin);
+
+    // Область узлов, заблокированных препятствиями; пустой прямоугольник, если таких нет
+    static QRect blockedExtent(const std::vector<QRect>& obstacles, int step);
+
+    // Узлы сетки, которые блокирует препятствие; пустой прямоугольник, если таких нет
+    static QRect blockedCells(const QRect& obstacle, int step);
+
+    const std::vector<QRect>& obstacles() const;
+
+    int step() const;
+    int width() const;
+    int height() const;
+    int cellCount() const;
+    QRect cellExtent() const;
+
+    bool contains(int gx, int gy) const;
+    int indexOf(int gx, int gy) const;
+    QPoint cellAt(int index) const;
+
+    // Узлы за пределами области считаются заблокированными
+    bool isBlocked(int gx, int gy) const;
+    bool isBlockedIndex(int index) const;
+
+    // Свободный узел, соседний с препятствием (в том числе по диагонали);
+    // граница области препятствием не считается
+    bool isNearObstacleIndex(int index) const;
+
+    // Перевод мировых координат в координаты сетки и обратно
+    static int toCell(int world, int step);
+    static QPoint toCell(const QPoint& world, int step);
+
+private:
+    void setBlocked(int index);
+    void markNear(int gx, int gy);
+
+    std::vector<QRect> m_obstacles;
+    std::vector<quint64> m_bits;
+    std::vector<quint64> m_nearBits;
+    QRect m_extent;
+    int m_step;
+};
+
+#endif // OCCUPANCY_GRID_H
@@ -0,0 +1,37 @@
+#ifndef POINT_INDEX_H
+#define POINT_INDEX_H
+
+#include <vector>
+#include <unordered_map>
+#include <QPoint>
+#include <QtGlobal>
+
+// Индекс точек для выбора мышью: равномерная сетка корзин по клеткам сцены.
+// Поиск ближайшей точки просматривает только корзины в пределах радиуса.
+class PointIndex {
+public:
+    explicit PointIndex(int bucketSize);
+
+    void insert(int id, const QPoint& position);
+    void remove(int id, const QPoint& position);
+    void move(int id, const QPoint& from, const QPoint& to);
+    void clear();
+    void reserve(size_t count);
+
+    // Ближайшая к pos точка не дальше radius; -1, если такой нет
+    int pick(const QPoint& pos, int radius) const;
+
+private:
+    struct Entry {
+        int id;
+        QPoint position;
+    };
+
+    int bucketOf(int coord) const;
+    static quint64 bucketKey(int bx, int by);
+
+    int m_bucketSize;
+    std::unordered_map<quint64, std::vector<Entry>> m_buckets;
+};
+
+#endif // POINT_INDEX_H
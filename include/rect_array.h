@@ -0,0 +1,45 @@
+#ifndef RECT_ARRAY_H
+#define RECT_ARRAY_H
+
+#include <vector>
+#include <QPoint>
+#include <QRect>
+#include <QtGlobal>
+
+// Прямоугольники в виде структуры массивов (x1, y1, x2, y2 по отдельности)
+// для пакетных проверок. Перебор идет блоками по 8 (AVX2) или 4 (SSE2)
+// прямоугольника за инструкцию; без SIMD работает скалярный вариант.
+// Координаты включительные, как у QRect::contains.
+class RectArray {
+public:
+    void clear();
+    void reserve(size_t count);
+    void append(const QRect& rect);
+    void set(size_t index, const QRect& rect);
+
+    // Удаление перестановкой последнего элемента на место удаляемого
+    void removeAt(size_t index);
+
+    size_t size() const;
+    bool empty() const;
+    QRect at(size_t index) const;
+
+    // Индекс первого прямоугольника не раньше from, пересекающего box
+    // (включительно по границам), или size(), если такого нет
+    size_t nextOverlapping(const QRect& box, size_t from = 0) const;
+
+    // Индекс первого прямоугольника, содержащего точку, или -1
+    int findContaining(const QPoint& pt) const;
+    bool containsPoint(const QPoint& pt) const;
+
+    // Используемый набор инструкций: "avx2", "sse2" или "scalar"
+    static const char* instructionSet();
+
+private:
+    std::vector<qint32> m_x1;
+    std::vector<qint32> m_y1;
+    std::vector<qint32> m_x2;
+    std::vector<qint32> m_y2;
+};
+
+#endif // RECT_ARRAY_H
@@ -2,23 +2,90 @@
 #define ROUTE_H
 
 #include <vector>
+#include <iterator>
+#include <cstddef>
 #include <QPoint>
 
+// Маршрут хранит путь сжато: только точки поворота и шаг сетки. Путь по сетке
+// (соседние узлы на одном расстоянии по одной оси) восстанавливается при обходе
+// cells() без выделения памяти. Прочие пути (например, отрезок между концами
+// недостижимого маршрута) хранятся как есть.
 class Route {
 public:
+    // Обход узлов пути с восстановлением промежуточных узлов между поворотами
+    class CellIterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = QPoint;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const QPoint*;
+        using reference = const QPoint&;
+
+        CellIterator() = default;
+
+        const QPoint& operator*() const { return m_current; }
+        const QPoint* operator->() const { return &m_current; }
+        CellIterator& operator++();
+        CellIterator operator++(int);
+
+        bool operator==(const CellIterator& other) const { return m_index == other.m_index; }
+        bool operator!=(const CellIterator& other) const { return m_index != other.m_index; }
+
+    private:
+        friend class Route;
+        CellIterator(const Route* route, size_t index);
+
+        const Route* m_route = nullptr;
+        size_t m_index = 0;
+        size_t m_nextCorner = 0;
+        QPoint m_current;
+    };
+
+    class Cells {
+    public:
+        CellIterator begin() const { return CellIterator(m_route, 0); }
+        CellIterator end() const { return CellIterator(m_route, m_route->m_length); }
+        size_t size() const { return m_route->m_length; }
+        bool empty() const { return m_route->m_length == 0; }
+        const QPoint& front() const { return m_route->m_corners.front(); }
+        const QPoint& back() const { return m_route->m_corners.back(); }
+
+    private:
+        friend class Route;
+        explicit Cells(const Route* route) : m_route(route) {}
+
+        const Route* m_route;
+    };
+
     Route(int id, int startId, int endId);
     
     int getId() const;
     int getStartId() const;
     int getEndId() const;
-    const std::vector<QPoint>& getPath() const;
+    
+    // Узлы пути в порядке обхода
+    Cells cells() const;
+    
+    // Путь целиком (выделяет память; для обхода достаточно cells())
+    std::vector<QPoint> getPath() const;
+    
     void setPath(const std::vector<QPoint>& path);
+    void setPath(std::vector<QPoint>&& path);
+    
+    // Только точки поворота пути: подряд идущие шаги в одном направлении
+    // объединены в один отрезок
+    const std::vector<QPoint>& getCorners() const;
     
 private:
+    // Шаг сетки пути или 0, если путь не по сетке и хранится как есть
+    static int gridStep(const std::vector<QPoint>& path);
+    
     int m_id;
     int m_startId;
     int m_endId;
-    std::vector<QPoint> m_path;
+    std::vector<QPoint> m_corners;
+    size_t m_length;
+    int m_step;
 };
 
-#endif // ROUTE_H
\ No newline at end of file
+#endif // ROUTE_H
@@ -0,0 +1,19 @@
+#ifndef ROUTE_BATCH_H
+#define ROUTE_BATCH_H
+
+#include <vector>
+#include <utility>
+#include <QPoint>
+
+// Концы маршрута: старт и цель
+using RouteEndpoints = std::pair<QPoint, QPoint>;
+
+namespace RouteBatch {
+
+// Индексы запросов, сгруппированные по точке старта, в порядке первого появления.
+// Маршруты одной группы строятся по одному дереву поиска.
+std::vector<std::vector<int>> groupBySource(const std::vector<RouteEndpoints>& endpoints);
+
+}
+
+#endif // ROUTE_BATCH_H
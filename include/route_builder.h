@@ -2,27 +2,83 @@
 #define ROUTE_BUILDER_H
 
 #include "i_route_builder.h"
-#include <QLineF>
+#include "grid_settings.h"
+#include "occupancy_grid.h"
+#include "search_workspace.h"
 
 class RouteBuilder : public IRouteBuilder {
 public:
-    RouteBuilder();
+    // Поиск одиночного маршрута. Двунаправленные режимы ведут поиск от обоих
+    // концов до встречи и всегда раскрывают меньшую сторону, поэтому цель,
+    // замкнутая препятствиями, обнаруживается за размер ее области, а не всей
+    // сетки. Длина пути во всех режимах одинаковая.
+    //
+    // При неравных стоимостях шагов (GridSettings::isUniform() == false) маршрут
+    // в любом режиме ищется взвешенным A* с очередью по корзинам
+    enum class SearchMode {
+        AStar,
+        BidirectionalBfs,
+        BidirectionalAStar
+    };
+
+    explicit RouteBuilder(SearchMode mode = SearchMode::AStar, const GridSettings& settings = GridSettings());
     
     std::vector<QPoint> buildRoute(
         const QPoint& start, 
         const QPoint& end, 
         const std::vector<QRect>& obstacles
     ) override;
+    std::vector<std::vector<QPoint>> buildRoutes(
+        const std::vector<RouteEndpoints>& endpoints,
+        const std::vector<QRect>& obstacles
+    ) override;
+    std::unique_ptr<IRouteBuilder> clone() const override;
+    SearchStats lastSearchStats() const override;
 
 private:
-    bool lineIntersectsRect(const QLineF& line, const QRect& rect) const;
-    bool segmentIntersectsBlocked(const QLineF& seg, const std::vector<QRect>& obstacles) const;
+    using OpenNode = SearchWorkspace::OpenNode;
+
     std::vector<QPoint> buildRouteInternal(
         const QPoint& a, 
         const QPoint& b, 
         const std::vector<QRect>& obstacles,
         int maxOffsetMultiplier = 5
     );
+    // Поиск в ширину от общего старта до всех целей группы
+    void buildRouteTree(
+        const std::vector<RouteEndpoints>& endpoints,
+        const std::vector<int>& group,
+        const std::vector<QRect>& obstacles,
+        std::vector<std::vector<QPoint>>& paths,
+        int maxOffsetMultiplier = 5
+    );
+    // Поиск между узлами карты; пустой результат - цель недостижима
+    std::vector<QPoint> searchAStar(int startIndex, int goalIndex, const QRect& bounds, int step);
+    std::vector<QPoint> searchBidirectionalBfs(int startIndex, int goalIndex, const QRect& bounds, int step);
+    std::vector<QPoint> searchBidirectionalAStar(int startIndex, int goalIndex, const QRect& bounds, int step);
+    // Поиск по узлам (узел сетки, направление входа) с ценами шагов из m_settings
+    std::vector<QPoint> searchWeighted(int startIndex, int goalIndex, const QRect& bounds, int step);
+
+    // Кратчайший путь по стоимостям узлов: exactCosts - стоимости всех узлов
+    // ближе цели точные (поиск в ширину), иначе они остались от A*
+    std::vector<QPoint> extractPath(int startIndex, int goalIndex, const QRect& bounds, int step, bool exactCosts);
+    // Лежит ли узел на расстоянии distance от старта, если ближе он лежать не
+    // может; length - длина найденного A* пути от start до goal
+    bool hasStartDistance(int index, int distance, int length,
+                          const QPoint& start, const QPoint& goal, const QRect& bounds);
+    // Путь через ребро встречи: forwardMeet - в дереве от старта, backwardMeet - от цели
+    std::vector<QPoint> extractPath(int startIndex, int goalIndex, int forwardMeet, int backwardMeet, int step) const;
+    std::vector<QPoint> extractWeightedPath(int goalState, int step) const;
+
+    SearchMode m_mode;
+    GridSettings m_settings;
+
+    // Карта занятости и рабочая память поиска переиспользуются между запросами;
+    // обратный поиск двунаправленных режимов ведется в отдельной памяти
+    OccupancyGrid m_grid;
+    SearchWorkspace m_workspace;
+    SearchWorkspace m_backward;
+    SearchStats m_stats;
 };
 
-#endif // ROUTE_BUILDER_H
\ No newline at end of file
+#endif // ROUTE_BUILDER_H
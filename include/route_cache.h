@@ -0,0 +1,60 @@
+#ifndef ROUTE_CACHE_H
+#define ROUTE_CACHE_H
+
+#include <list>
+#include <unordered_map>
+#include <vector>
+#include <QPoint>
+#include <QtGlobal>
+
+// Кэш построенных маршрутов с вытеснением давно не использованных (LRU).
+// Ключ - концы маршрута и версия набора препятствий. Версия только растет,
+// поэтому записи старых версий никогда не совпадут и удаляются при смене версии.
+class RouteCache {
+public:
+    struct Stats {
+        quint64 hits = 0;
+        quint64 misses = 0;
+        size_t size = 0;
+        size_t capacity = 0;
+    };
+
+    explicit RouteCache(size_t capacity);
+
+    // Путь из кэша или nullptr; указатель действителен до следующего изменения кэша
+    const std::vector<QPoint>* find(const QPoint& start, const QPoint& goal, quint64 version);
+    void insert(const QPoint& start, const QPoint& goal, quint64 version, const std::vector<QPoint>& path);
+    void clear();
+
+    Stats stats() const;
+
+private:
+    struct Key {
+        QPoint start;
+        QPoint goal;
+        quint64 version;
+
+        bool operator==(const Key& other) const
+        {
+            return start == other.start && goal == other.goal && version == other.version;
+        }
+    };
+
+    struct KeyHash {
+        size_t operator()(const Key& key) const;
+    };
+
+    struct Entry {
+        Key key;
+        std::vector<QPoint> path;
+    };
+
+    size_t m_capacity;
+    quint64 m_version;
+    std::list<Entry> m_entries;
+    std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> m_lookup;
+    quint64 m_hits;
+    quint64 m_misses;
+};
+
+#endif // ROUTE_CACHE_H
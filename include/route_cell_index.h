@@ -0,0 +1,40 @@
+#ifndef ROUTE_CELL_INDEX_H
+#define ROUTE_CELL_INDEX_H
+
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+#include <QPoint>
+#include <QRect>
+#include <QtGlobal>
+#include "route.h"
+
+// Обратный индекс: узел сетки -> маршруты, пути которых через него проходят.
+// Новое препятствие делает недействительными только маршруты в заблокированных
+// им узлах, поэтому их поиск не зависит от числа и длины остальных маршрутов.
+class RouteCellIndex {
+public:
+    explicit RouteCellIndex(int step);
+
+    // Индексируются точки пути в узлах сетки, в том числе концы недостижимого
+    // маршрута: они привязаны к сетке, и препятствие на конце перестроит такой
+    // маршрут впустую, но не пропустит его. Точки вне узлов пропускаются
+    void insert(const Route& route);
+    void remove(const Route& route);
+    void clear();
+
+    // Добавляет в routes маршруты, проходящие через узлы, которые блокирует
+    // препятствие, или через узлы не дальше margin от них
+    void collect(const QRect& obstacle, std::unordered_set<int>& routes, int margin = 0) const;
+
+    size_t cellCount() const;
+
+private:
+    bool cellOf(const QPoint& pt, quint64& key) const;
+    static quint64 key(int gx, int gy);
+
+    int m_step;
+    std::unordered_map<quint64, std::vector<int>> m_cells;
+};
+
+#endif // ROUTE_CELL_INDEX_H
@@ -0,0 +1,40 @@
+#ifndef ROUTE_PATHS_H
+#define ROUTE_PATHS_H
+
+#include <vector>
+#include <QPoint>
+#include <QRect>
+
+// Пути всех маршрутов в одном непрерывном буфере точек (точки поворота).
+// Маршрут i занимает точки [offset(i), offset(i + 1)).
+class RoutePaths {
+public:
+    // Представление пути без копирования
+    struct PathView {
+        const QPoint* data;
+        int size;
+
+        const QPoint* begin() const { return data; }
+        const QPoint* end() const { return data + size; }
+    };
+
+    RoutePaths();
+
+    void clear();
+    void reserve(size_t routeCount, size_t pointCount);
+    void append(const std::vector<QPoint>& path);
+
+    size_t count() const;
+    PathView path(size_t index) const;
+    QRect bounds(size_t index) const;
+
+    const std::vector<QPoint>& points() const;
+    const std::vector<int>& offsets() const;
+
+private:
+    std::vector<QPoint> m_points;
+    std::vector<int> m_offsets;
+    std::vector<QRect> m_bounds;
+};
+
+#endif // ROUTE_PATHS_H
@@ -0,0 +1,113 @@
+#ifndef ROUTING_STATS_H
+#define ROUTING_STATS_H
+
+#include "i_route_builder.h"
+#include <QtGlobal>
+#include <atomic>
+
+// Гистограмма длительностей в микросекундах: на каждую степень двойки
+// по 4 корзины, поэтому перцентиль завышается не больше чем на четверть.
+// Запись - один атомарный инкремент без блокировок.
+class LatencyHistogram {
+public:
+    LatencyHistogram();
+
+    // count одинаковых записей одним инкрементом
+    void record(quint64 micros, quint64 count = 1);
+    void reset();
+
+    quint64 count() const;
+
+    // Верхняя граница корзины, в которую попадает доля fraction (0..1) записей;
+    // 0, если записей нет
+    quint64 percentile(double fraction) const;
+
+private:
+    static const int SubBucketBits = 2;
+    static const int BucketCount = 64 << SubBucketBits;
+
+    static int bucketOf(quint64 value);
+    static quint64 upperBound(int bucket);
+
+    std::atomic<quint64> m_buckets[BucketCount];
+};
+
+// Счетчики маршрутизации: отдельные поиски (вызовы построителя) и перестроения
+// маршрутов сцены. Счетчики атомарные, писать в них могут одновременно все
+// потоки построения.
+//
+// Сбор включается опцией сборки GRIDVIEW_ENABLE_STATS. Без нее Enabled равно
+// false, и код записи в местах вызова отбрасывается компилятором.
+class RoutingStats {
+public:
+#ifdef GRIDVIEW_ENABLE_STATS
+    static const bool Enabled = true;
+#else
+    static const bool Enabled = false;
+#endif
+
+    // Значения на момент вызова snapshot(); поля читаются по отдельности,
+    // поэтому при параллельной записи могут быть немного несогласованы
+    struct Snapshot {
+        bool enabled = false;
+
+        // Поиски: одиночные запросы и пакеты с общим деревом поиска
+        quint64 searches = 0;
+        quint64 routesSearched = 0;
+        quint64 unreachable = 0;
+        quint64 nodesExpanded = 0;
+        quint64 pathPoints = 0;
+        int openListPeak = 0;
+
+        // Время поиска одного маршрута: пакет дает по записи на маршрут
+        // со средним временем маршрута в нем
+        quint64 searchTimeP50 = 0;
+        quint64 searchTimeP99 = 0;
+        quint64 searchTimeMax = 0;
+
+        // Перестроения маршрутов сцены
+        quint64 rebuilds = 0;
+        quint64 routesReplanned = 0;
+        quint64 routesRepaired = 0;
+        quint64 routesFromCache = 0;
+        int lastRebuildRoutes = 0;
+        quint64 rebuildTimeP99 = 0;
+    };
+
+    RoutingStats();
+
+    // Поиск маршрутов routeCount с суммарной длиной путей pathPoints
+    void recordSearch(const SearchStats& search, int routeCount, quint64 pathPoints, quint64 micros);
+
+    // Перестроение: маршруты, найденные поиском с нуля и исправленные
+    // инкрементальным планировщиком
+    void recordRebuild(int replanned, int repaired, quint64 micros);
+
+    // Маршруты, пути которых взяты из кэша без поиска
+    void recordCacheHits(int count);
+
+    Snapshot snapshot() const;
+    void reset();
+
+private:
+    static void updateMax(std::atomic<int>& target, int value);
+    static void updateMax(std::atomic<quint64>& target, quint64 value);
+
+    std::atomic<quint64> m_searches;
+    std::atomic<quint64> m_routesSearched;
+    std::atomic<quint64> m_unreachable;
+    std::atomic<quint64> m_nodesExpanded;
+    std::atomic<quint64> m_pathPoints;
+    std::atomic<int> m_openListPeak;
+    std::atomic<quint64> m_searchTimeMax;
+    LatencyHistogram m_searchTime;
+
+    std::atomic<quint64> m_rebuilds;
+    std::atomic<quint64> m_routesReplanned;
+    std::atomic<quint64> m_routesRepaired;
+    std::atomic<quint64> m_routesFromCache;
+    std::atomic<int> m_lastRebuildRoutes;
+    LatencyHistogram m_rebuildTime;
+};
+
+#endif // ROUTING_STATS_H
@@ -4,48 +4,133 @@
 #include "i_scene.h"
 #include "i_element_manager.h"
 #include "i_route_builder.h"
-#include "point.h"
-#include "obstacle.h"
+#include "grid_settings.h"
 #include "route.h"
+#include "incremental_planner.h"
+#include "obstacle_index.h"
+#include "point_index.h"
+#include "route_cell_index.h"
+#include "rect_array.h"
+#include "async_route_planner.h"
+#include "routing_stats.h"
+#include <QElapsedTimer>
+#include <QThreadPool>
+#include <map>
 #include <memory>
+#include <set>
+#include <unordered_set>
 #include <vector>
 
 class Scene : public IScene {
 public:
+    // Построитель должен искать маршруты на сетке с теми же параметрами settings
     Scene(std::unique_ptr<IElementManager> elementManager, 
-          std::unique_ptr<IRouteBuilder> routeBuilder);
+          std::unique_ptr<IRouteBuilder> routeBuilder,
+          const GridSettings& settings = GridSettings());
     
     // Управление элементами
     int addPoint(const QPoint& position) override;
-    void addObstacle(const QRect& bounds) override;
+    int addObstacle(const QRect& bounds) override;
     void removeElement(int id) override;
+    bool movePoint(int id, const QPoint& position) override;
+    int addPoints(const std::vector<QPoint>& positions) override;
+    int addObstacles(const std::vector<QRect>& bounds) override;
+    void beginBatch() override;
+    void commitBatch() override;
     
-    // Получение элементов
-    IElement* getElement(int id) override;
-    const std::vector<std::unique_ptr<IElement>>& getAllElements() const override;
-    std::vector<IElement*> getAllElementsPtr() override;
+    // Получение точек
+    bool getPointPosition(int id, QPoint& position) const override;
+    const std::vector<int>& getPointIds() const override;
+    const std::vector<QPoint>& getPointPositions() const override;
+    int pickPoint(const QPoint& worldPos, int radius) const override;
     
     // Работа с препятствиями
     const std::vector<QRect>& getObstacles() const override;
+    quint64 getObstaclesVersion() const override;
     
     // Работа с маршрутами
     bool buildRoute(int startId, int endId) override;
-    const std::vector<std::vector<QPoint>>& getRoutes() const override;
+    const RoutePaths& getRoutes() const override;
+    const std::vector<Route>& getRouteList() const override;
+    bool addRoute(int startId, int endId, const std::vector<QPoint>& path) override;
+    size_t addRoutes(const std::vector<int>& endpointIds, const std::vector<QPoint>& pathPoints,
+                     const std::vector<quint64>& pathOffsets) override;
     void removeRoutesWithPoint(int pointId) override;
     void rebuildRoutes() override;
+    void setRebuildThreadCount(int count) override;
+    RouteCache::Stats getRouteCacheStats() const override;
+    RoutingStats::Snapshot getRoutingStats() const override;
+    void resetRoutingStats() override;
+    void requestRouteRebuild() override;
+    void setRoutesUpdatedHandler(std::function<void()> handler) override;
+    QRect takeDirtyRect() override;
     
     // Вспомогательные функции
+    const GridSettings& getGridSettings() const override;
     QPoint snapToGrid(const QPoint& p) const override;
     bool isInsideBlockedCell(const QPoint& pt) const override;
 
 private:
+    // Состояние инкрементального перестроения маршрута при перетаскивании
+    struct RepairSlot {
+        std::unique_ptr<IncrementalPlanner> planner;
+        quint64 lastUsed = 0;
+    };
+
+    // Объявлена первой: построители и фоновые потоки пишут в нее до своего уничтожения
+    RoutingStats m_routingStats;
+    
     std::unique_ptr<IElementManager> m_elementManager;
     std::unique_ptr<IRouteBuilder> m_routeBuilder;
     std::vector<Route> m_routes;
-    std::vector<QRect> m_obstacles;
-    int m_cellSize;
+    RoutePaths m_routePaths;
+    RoutePaths m_spareRoutePaths;
+    QRect m_dirtyRect;
+    quint64 m_obstaclesVersion;
+    RouteCache m_routeCache;
+    GridSettings m_gridSettings;
+    ObstacleIndex m_obstacleIndex;
+    PointIndex m_pointIndex;
+    RouteCellIndex m_routeCells;
+    int m_nextElementId;
+    int m_nextRouteId;
+
+    // Изменения с момента последнего перестроения маршрутов
+    std::set<int> m_movedPoints;
+    RectArray m_addedObstacles;
+    RectArray m_removedObstacles;
+    
+    // Открытый пакет изменений: версия препятствий и перестроение отложены
+    int m_batchDepth;
+    bool m_batchObstaclesChanged;
+    bool m_batchRebuildRequested;
+
+    std::map<int, RepairSlot> m_repairSlots;
+    quint64 m_repairTick;
+    
+    // Параллельное перестроение: у каждого потока свой построитель
+    int m_rebuildThreadCount;
+    std::vector<std::unique_ptr<IRouteBuilder>> m_workerBuilders;
+    QThreadPool m_rebuildPool;
+    
+    // Маршруты, отправленные на асинхронное перестроение и еще не обновленные
+    std::set<int> m_pendingRoutes;
+    std::function<void()> m_routesUpdatedHandler;
+    std::unique_ptr<AsyncRoutePlanner> m_asyncPlanner;
+    QElapsedTimer m_asyncRebuildTimer;
     
+    void markObstaclesChanged(const std::vector<QRect>& added, const std::vector<QRect>& removed);
+    bool hasPendingChanges() const;
     std::vector<Route> findRoutesWithPoint(int pointId);
+    const std::vector<QRect>& obstacles() const;
+    std::unordered_set<int> collectAffectedRoutes() const;
+    bool canRemovalShorten(const Route& route) const;
+    void setRoutePath(Route& route, std::vector<QPoint> path);
+    std::vector<QPoint> repairRoute(const Route& route, const QPoint& start, const QPoint& end);
+    void replanRoutes(const std::vector<Route*>& routes);
+    void removeDanglingRoutes();
+    void refreshRoutePaths();
+    void applyPlannedRoutes(const AsyncRoutePlanner::Result& result);
 };
 
 #endif // SCENE_H
\ No newline at end of file
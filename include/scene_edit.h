@@ -0,0 +1,33 @@
+#ifndef SCENE_EDIT_H
+#define SCENE_EDIT_H
+
+#include "i_scene.h"
+
+// Транзакция изменения сцены: открывает пакет в конструкторе и применяет
+// его в деструкторе (или раньше, вызовом commit). Все изменения внутри
+// обходятся одним перестроением затронутых маршрутов:
+//
+//   {
+//       SceneEdit edit(*scene);
+//       for (const QRect& rc : rects)
+//           edit->addObstacle(rc);
+//   }
+class SceneEdit {
+public:
+    explicit SceneEdit(IScene& scene);
+    ~SceneEdit();
+
+    SceneEdit(const SceneEdit&) = delete;
+    SceneEdit& operator=(const SceneEdit&) = delete;
+
+    IScene* operator->() const;
+
+    // Применяет изменения до конца области видимости
+    void commit();
+
+private:
+    IScene& m_scene;
+    bool m_active;
+};
+
+#endif // SCENE_EDIT_H
@@ -2,11 +2,29 @@
 #define SCENE_FACTORY_H
 
 #include "i_scene.h"
+#include "i_route_builder.h"
+#include "grid_settings.h"
 #include <memory>
 
+// Алгоритм поиска маршрутов на сетке
+enum class RoutingAlgorithm {
+    AStar,              // A* по всем узлам; пакеты с общим стартом - одним деревом
+    BidirectionalBfs,   // поиск в ширину от обоих концов до встречи
+    BidirectionalAStar, // A* от обоих концов до встречи
+    JumpPoint,          // поиск с прыжками (JPS)
+    JumpPointTables,    // JPS с заранее посчитанными таблицами прыжков (JPS+)
+    Hierarchical        // иерархический поиск по кластерам (HPA*) для больших сцен
+};
+
+// Сцена и ее построитель получают одни и те же параметры сетки. JPS и HPA*
+// рассчитаны на равноценные шаги: при неравных стоимостях вместо них
+// создается RouteBuilder со взвешенным поиском.
 class SceneFactory {
 public:
-    static std::unique_ptr<IScene> createScene();
+    static std::unique_ptr<IScene> createScene(RoutingAlgorithm algorithm = RoutingAlgorithm::AStar,
+                                               const GridSettings& settings = GridSettings());
+    static std::unique_ptr<IRouteBuilder> createRouteBuilder(RoutingAlgorithm algorithm,
+                                                             const GridSettings& settings = GridSettings());
 };
 
-#endif // SCENE_FACTORY_H
\ No newline at end of file
+#endif // SCENE_FACTORY_H
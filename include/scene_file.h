@@ -0,0 +1,37 @@
+#ifndef SCENE_FILE_H
+#define SCENE_FILE_H
+
+#include "i_scene.h"
+#include <QString>
+#include <QtGlobal>
+
+// Двоичный формат сцены. Файл - заголовок, таблица секций и секции
+// фиксированной раскладки (little-endian, начало каждой секции выровнено
+// на 64 байта):
+//   Points       - int32 x, y
+//   Obstacles    - int32 left, top, right, bottom (включительно, как у QRect)
+//   Routes       - uint32 индексы начальной и конечной точки в секции Points
+//   PathOffsets  - uint64, маршрут i занимает точки [offset[i], offset[i + 1])
+//   PathPoints   - int32 x, y - сохраненные пути маршрутов
+//   Settings     - int32 cellSize, stepCost, nearObstacleCost, turnCost - параметры
+//                  сетки, с которыми найдены пути (с версии 2)
+//
+// Загрузка отображает файл в память (QFile::map) и читает секции напрямую,
+// без разбора. Пути маршрутов берутся из файла, поэтому загруженная сцена
+// отрисовывается сразу, без перестроения, если параметры сетки сцены совпадают
+// с сохраненными; иначе маршруты строятся заново. Маршрут с пустым путем
+// загружается недостижимым, а не пропускается. Секции неизвестных типов
+// пропускаются.
+class SceneFile {
+public:
+    static const quint32 Version = 2;
+
+    // Сохраняет точки, препятствия и маршруты сцены с их текущими путями
+    static bool save(const IScene& scene, const QString& fileName, QString* error = nullptr);
+
+    // Добавляет содержимое файла в сцену. Файл проверяется целиком до изменения
+    // сцены: при ошибке сцена остается прежней
+    static bool load(IScene& scene, const QString& fileName, QString* error = nullptr);
+};
+
+#endif // SCENE_FILE_H
@@ -0,0 +1,39 @@
+#ifndef SCENE_STREAM_H
+#define SCENE_STREAM_H
+
+#include "i_scene.h"
+#include <QIODevice>
+#include <QString>
+
+// Потоковый импорт и экспорт точек и препятствий в текстовых форматах
+// внешних инструментов. Вход читается блоками фиксированного размера,
+// элементы передаются в сцену пакетами (IScene::addPoints/addObstacles),
+// поэтому память не зависит от размера файла. Существующие маршруты
+// перестраиваются один раз, после чтения всего файла.
+//
+// CSV: по строке на элемент, '#' - комментарий, строка заголовка допускается:
+//   point,x,y
+//   obstacle,x,y,width,height
+//
+// JSON: объект с массивами "points" и "obstacles", прочие ключи пропускаются:
+//   { "points": [[x, y], ...], "obstacles": [[x, y, width, height], ...] }
+//
+// Дробные координаты округляются, точки привязываются к сетке сцены
+// (IScene::snapToGrid). Строка CSV длиннее 4 КБ - ошибка. При ошибке разбора
+// элементы, прочитанные до нее, остаются в сцене.
+class SceneStream {
+public:
+    enum class Format {
+        Csv,
+        Json
+    };
+
+    static bool importScene(IScene& scene, QIODevice& device, Format format, QString* error = nullptr);
+    static bool exportScene(const IScene& scene, QIODevice& device, Format format, QString* error = nullptr);
+
+    // Формат определяется по расширению файла (.json, иначе CSV)
+    static bool importFile(IScene& scene, const QString& fileName, QString* error = nullptr);
+    static bool exportFile(const IScene& scene, const QString& fileName, QString* error = nullptr);
+};
+
+#endif // SCENE_STREAM_H
@@ -0,0 +1,93 @@
+#ifndef SEARCH_WORKSPACE_H
+#define SEARCH_WORKSPACE_H
+
+#include "bucket_queue.h"
+#include <vector>
+#include <limits>
+#include <QtGlobal>
+
+// Рабочая память поиска по узлам сетки: стоимость и родитель узла, открытый
+// список и очередь. Каждый узел помечен поколением запроса, в котором он был
+// достигнут; узлы с чужим поколением считаются непосещенными. Поэтому новый
+// запрос не очищает массивы, а только увеличивает поколение, и после первых
+// запросов поиск не выделяет память.
+//
+// Не потокобезопасна: у каждого построителя (и каждой его копии из clone())
+// своя рабочая память.
+class SearchWorkspace {
+public:
+    struct OpenNode {
+        int f;
+        int g;
+        int index;
+    };
+
+    SearchWorkspace();
+
+    // Начинает новый запрос на nodeCount узлах: все узлы становятся
+    // непосещенными, открытый список и очередь - пустыми
+    void reset(int nodeCount);
+
+    bool isVisited(int index) const
+    {
+        return m_nodes[index].generation == m_generation;
+    }
+
+    // Стоимость пути до узла или INT_MAX для непосещенного узла
+    int cost(int index) const
+    {
+        return isVisited(index) ? m_nodes[index].cost : std::numeric_limits<int>::max();
+    }
+
+    // Предыдущий узел пути или -1 для непосещенного узла; у старта - он сам
+    int parent(int index) const
+    {
+        return isVisited(index) ? m_nodes[index].parent : -1;
+    }
+
+    void visit(int index, int cost, int parent)
+    {
+        Node& node = m_nodes[index];
+        node.generation = m_generation;
+        node.cost = cost;
+        node.parent = parent;
+    }
+
+    // Пометки узлов (например, целей пакетного поиска) в текущем запросе
+    void mark(int index)
+    {
+        m_marks[index] = m_generation;
+    }
+
+    bool isMarked(int index) const
+    {
+        return m_marks[index] == m_generation;
+    }
+
+    // Двоичная куча открытого списка A*
+    std::vector<OpenNode>& open();
+
+    // Очередь поиска в ширину: каждый узел попадает в нее не больше одного
+    // раза, поэтому ее емкость резервируется на все узлы и не растет
+    std::vector<int>& queue();
+
+    // Очередь взвешенного поиска; разброс ключей задает сам поиск при reset()
+    BucketQueue& buckets();
+
+private:
+    // Поля узла рядом: раскрытие узла читает одну строку кэша
+    struct Node {
+        quint32 generation;
+        int cost;
+        int parent;
+    };
+
+    std::vector<Node> m_nodes;
+    std::vector<quint32> m_marks;
+    std::vector<OpenNode> m_open;
+    std::vector<int> m_queue;
+    BucketQueue m_buckets;
+    quint32 m_generation;
+};
+
+#endif // SEARCH_WORKSPACE_H
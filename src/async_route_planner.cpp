@@ -0,0 +1,75 @@
+#include "async_route_planner.h"
+#include <QMetaObject>
+
+AsyncRoutePlanner::AsyncRoutePlanner(std::unique_ptr<IRouteBuilder> builder, ResultHandler handler)
+    : m_builder(std::move(builder))
+    , m_handler(std::move(handler))
+    , m_generation(0)
+{
+    // Один фоновый поток: задания выполняются строго по очереди,
+    // поэтому построитель не требует синхронизации
+    m_pool.setMaxThreadCount(1);
+}
+
+AsyncRoutePlanner::~AsyncRoutePlanner()
+{
+    cancel();
+    m_pool.waitForDone();
+}
+
+quint64 AsyncRoutePlanner::submit(Job job)
+{
+    quint64 generation = ++m_generation;
+
+    // Задания, которые еще не начали выполняться, больше не нужны
+    m_pool.clear();
+    m_pool.start([this, generation, job = std::move(job)]() {
+        run(generation, job);
+    });
+
+    return generation;
+}
+
+void AsyncRoutePlanner::cancel()
+{
+    ++m_generation;
+    m_pool.clear();
+}
+
+void AsyncRoutePlanner::run(quint64 generation, const Job& job)
+{
+    Result result;
+    result.generation = generation;
+    result.routeIds = job.routeIds;
+    result.endpoints = job.endpoints;
+    result.obstaclesVersion = job.obstaclesVersion;
+    result.paths.resize(job.endpoints.size());
+
+    // Маршруты с общим стартом строятся одним пакетом по общему дереву поиска
+    std::vector<RouteEndpoints> batch;
+    for (const std::vector<int>& group : RouteBatch::groupBySource(job.endpoints)) {
+        // Задание устарело: более новое уже в очереди
+        if (isStale(generation))
+            return;
+
+        batch.clear();
+        for (int i : group)
+            batch.push_back(job.endpoints[i]);
+
+        std::vector<std::vector<QPoint>> paths = m_builder->buildRoutes(batch, job.obstacles);
+        for (size_t k = 0; k < paths.size(); ++k)
+            result.paths[group[k]] = std::move(paths[k]);
+    }
+
+    // Передаем результат в поток планировщика; там поколение проверяется
+    // еще раз, так как за время доставки могло прийти новое задание
+    QMetaObject::invokeMethod(&m_context, [this, result = std::move(result)]() {
+        if (!isStale(result.generation))
+            m_handler(result);
+    }, Qt::QueuedConnection);
+}
+
+bool AsyncRoutePlanner::isStale(quint64 generation) const
+{
+    return generation != m_generation.load();
+}
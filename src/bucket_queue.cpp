@@ -0,0 +1,61 @@
+#include "bucket_queue.h"
+
+BucketQueue::BucketQueue()
+    : m_bucketCount(0)
+    , m_current(0)
+    , m_size(0)
+    , m_anchored(false)
+{
+}
+
+void BucketQueue::reset(int span)
+{
+    m_bucketCount = span + 1;
+    if (static_cast<int>(m_buckets.size()) < m_bucketCount)
+        m_buckets.resize(m_bucketCount);
+    for (int i = 0; i < m_bucketCount; ++i)
+        m_buckets[i].clear();
+
+    m_current = 0;
+    m_size = 0;
+    m_anchored = false;
+}
+
+void BucketQueue::push(int key, int value)
+{
+    // Отсчет ведется от первого ключа после reset(). Опустевшую очередь нельзя
+    // переносить на новый ключ: следующие могут быть меньше его
+    if (!m_anchored) {
+        m_current = key;
+        m_anchored = true;
+    }
+
+    m_buckets[key % m_bucketCount].push_back(value);
+    ++m_size;
+}
+
+bool BucketQueue::empty() const
+{
+    return m_size == 0;
+}
+
+int BucketQueue::size() const
+{
+    return m_size;
+}
+
+int BucketQueue::pop(int& key)
+{
+    // Все ключи лежат в [m_current, m_current + span], поэтому первая непустая
+    // корзина по кругу от текущей содержит наименьший ключ
+    while (m_buckets[m_current % m_bucketCount].empty())
+        ++m_current;
+
+    std::vector<int>& bucket = m_buckets[m_current % m_bucketCount];
+    int value = bucket.back();
+    bucket.pop_back();
+    --m_size;
+
+    key = m_current;
+    return value;
+}
@@ -1,52 +1,183 @@
 #include "element_manager.h"
 #include <algorithm>
 
+namespace {
+
+// Удаляет элемент перестановкой с последним элементом массива
+template <typename T>
+void swapAndPop(std::vector<T>& pool, int index)
+{
+    pool[index] = std::move(pool.back());
+    pool.pop_back();
+}
+
+// Запас под пакет; растет не меньше чем вдвое, как при вставке по одному
+template <typename T>
+void reserveForAppend(std::vector<T>& pool, size_t count)
+{
+    size_t required = pool.size() + count;
+    if (required > pool.capacity())
+        pool.reserve(std::max(required, 2 * pool.size()));
+}
+
+}
+
 ElementManager::ElementManager()
-    : m_nextId(0)
 {
 }
 
-void ElementManager::addElement(std::unique_ptr<IElement> element)
+void ElementManager::addPoint(int id, const QPoint& position)
+{
+    Slot& slot = allocateSlot(id, Kind::Point);
+    slot.index = static_cast<int>(m_pointIds.size());
+    
+    m_pointIds.push_back(id);
+    m_pointPositions.push_back(position);
+}
+
+bool ElementManager::setPointPosition(int id, const QPoint& position)
+{
+    const Slot* slot = findSlot(id);
+    if (!slot || slot->kind != Kind::Point) {
+        return false;
+    }
+    
+    m_pointPositions[slot->index] = position;
+    return true;
+}
+
+bool ElementManager::getPointPosition(int id, QPoint& position) const
+{
+    const Slot* slot = findSlot(id);
+    if (!slot || slot->kind != Kind::Point) {
+        return false;
+    }
+    
+    position = m_pointPositions[slot->index];
+    return true;
+}
+
+const std::vector<int>& ElementManager::getPointIds() const
+{
+    return m_pointIds;
+}
+
+const std::vector<QPoint>& ElementManager::getPointPositions() const
+{
+    return m_pointPositions;
+}
+
+void ElementManager::addPoints(int firstId, const std::vector<QPoint>& positions)
 {
-    m_elementMap[element->getId()] = element.get();
-    m_elements.push_back(std::move(element));
+    reserveSlots(firstId, positions.size());
+    reserveForAppend(m_pointIds, positions.size());
+    reserveForAppend(m_pointPositions, positions.size());
+    
+    for (size_t i = 0; i < positions.size(); ++i)
+        addPoint(firstId + static_cast<int>(i), positions[i]);
 }
 
-void ElementManager::removeElement(int id)
+void ElementManager::addObstacle(int id, const QRect& bounds)
 {
-    auto it = std::find_if(m_elements.begin(), m_elements.end(),
-        [id](const std::unique_ptr<IElement>& element) {
-            return element->getId() == id;
-        });
+    Slot& slot = allocateSlot(id, Kind::Obstacle);
+    slot.index = static_cast<int>(m_obstacleIds.size());
     
-    if (it != m_elements.end()) {
-        m_elementMap.erase(id);
-        m_elements.erase(it);
+    m_obstacleIds.push_back(id);
+    m_obstacleBounds.push_back(bounds);
+}
+
+bool ElementManager::getObstacleBounds(int id, QRect& bounds) const
+{
+    const Slot* slot = findSlot(id);
+    if (!slot || slot->kind != Kind::Obstacle) {
+        return false;
     }
+    
+    bounds = m_obstacleBounds[slot->index];
+    return true;
+}
+
+const std::vector<int>& ElementManager::getObstacleIds() const
+{
+    return m_obstacleIds;
+}
+
+const std::vector<QRect>& ElementManager::getObstacleBounds() const
+{
+    return m_obstacleBounds;
+}
+
+void ElementManager::addObstacles(int firstId, const std::vector<QRect>& bounds)
+{
+    reserveSlots(firstId, bounds.size());
+    reserveForAppend(m_obstacleIds, bounds.size());
+    reserveForAppend(m_obstacleBounds, bounds.size());
+    
+    for (size_t i = 0; i < bounds.size(); ++i)
+        addObstacle(firstId + static_cast<int>(i), bounds[i]);
 }
 
-IElement* ElementManager::getElement(int id)
+bool ElementManager::removeElement(int id)
 {
-    auto it = m_elementMap.find(id);
-    if (it != m_elementMap.end()) {
-        return it->second;
+    const Slot* found = findSlot(id);
+    if (!found) {
+        return false;
     }
-    return nullptr;
+    
+    Slot slot = *found;
+    m_slots[id] = Slot();
+    
+    if (slot.kind == Kind::Point) {
+        int movedId = m_pointIds.back();
+        swapAndPop(m_pointIds, slot.index);
+        swapAndPop(m_pointPositions, slot.index);
+        if (movedId != id)
+            m_slots[movedId].index = slot.index;
+    } else {
+        int movedId = m_obstacleIds.back();
+        swapAndPop(m_obstacleIds, slot.index);
+        swapAndPop(m_obstacleBounds, slot.index);
+        if (movedId != id)
+            m_slots[movedId].index = slot.index;
+    }
+    
+    return true;
+}
+
+bool ElementManager::contains(int id) const
+{
+    return findSlot(id) != nullptr;
 }
 
-const std::vector<std::unique_ptr<IElement>>& ElementManager::getAllElements() const
+const ElementManager::Slot* ElementManager::findSlot(int id) const
 {
-    return m_elements;
+    if (id < 0 || id >= static_cast<int>(m_slots.size())) {
+        return nullptr;
+    }
+    
+    const Slot& slot = m_slots[id];
+    return slot.kind != Kind::None ? &slot : nullptr;
 }
 
-std::vector<IElement*> ElementManager::getAllElementsPtr()
+ElementManager::Slot& ElementManager::allocateSlot(int id, Kind kind)
 {
-    std::vector<IElement*> elements;
-    elements.reserve(m_elements.size());
+    if (id >= static_cast<int>(m_slots.size())) {
+        m_slots.resize(id + 1);
+    }
     
-    for (const auto& element : m_elements) {
-        elements.push_back(element.get());
+    // Элемент с тем же идентификатором заменяется
+    if (m_slots[id].kind != Kind::None) {
+        removeElement(id);
     }
     
-    return elements;
-}
\ No newline at end of file
+    m_slots[id].kind = kind;
+    return m_slots[id];
+}
+
+void ElementManager::reserveSlots(int firstId, size_t count)
+{
+    // Таблица растет один раз на весь пакет, а не по элементу
+    size_t required = static_cast<size_t>(firstId) + count;
+    if (required > m_slots.size())
+        m_slots.resize(required);
+}
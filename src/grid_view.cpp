@@ -1,82 +1,193 @@
 #include "grid_view.h"
+#include "scene_file.h"
+#include <QFileDialog>
+#include <QMessageBox>
+#include <QElapsedTimer>
+#include <QStringList>
 #include <QPainter>
 #include <QMouseEvent>
 #include <QKeyEvent>
 #include <algorithm>
-#include "point.h"
-#include "obstacle.h"
-#include "route.h"
+#include <cmath>
 
 GridView::GridView(std::unique_ptr<IScene> scene, QWidget *parent) 
     : QWidget(parent)
     , m_scene(std::move(scene))
 {
     setFocusPolicy(Qt::StrongFocus);
+    setAttribute(Qt::WA_OpaquePaintEvent);
+    
+    // Маршруты перестраиваются в фоне; перерисовываемся, когда они готовы
+    m_scene->setRoutesUpdatedHandler([this]() {
+        QRect dirty = m_scene->takeDirtyRect();
+        if (dirty.isValid())
+            update(worldToScreen(dirty));
+    });
+    
+    // Оверлей обновляется по таймеру, даже если сцена не перерисовывается
+    m_statsTimer.setInterval(500);
+    connect(&m_statsTimer, &QTimer::timeout, this, [this]() {
+        update(statsOverlayRect());
+    });
 }
 
-void GridView::paintEvent(QPaintEvent *)
+void GridView::paintEvent(QPaintEvent *e)
 {
-    QPainter p(this);
+    QElapsedTimer frameTimer;
+    frameTimer.start();
 
-    p.fillRect(rect(), Qt::white);
+    QPainter p(this);
+    QRect exposed = e->rect();
 
-    // Рисуем сетку
-    p.setPen(QPen(Qt::lightGray, 1));
-    for (int x = 0; x < width(); x += 25 * m_scale)
-        p.drawLine(x, 0, x, height());
+    // Статический слой: сетка и препятствия
+    if (!isStaticLayerValid())
+        renderStaticLayer();
 
-    for (int y = 0; y < height(); y += 25 * m_scale)
-        p.drawLine(0, y, width(), y);
+    double dpr = m_staticLayer.devicePixelRatio();
+    p.drawPixmap(exposed, m_staticLayer, QRect(exposed.topLeft() * dpr, exposed.size() * dpr));
 
+    p.setClipRect(exposed);
     p.save();
     p.scale(m_scale, m_scale);
 
-    // Рисуем препятствия
-    p.setPen(Qt::NoPen);
-    p.setBrush(QColor(255, 100, 100));
-    for (const QRect& rect : m_scene->getObstacles())
-        p.drawRect(rect);
+    // Видимая часть сцены с запасом на толщину линий и радиус точек
+    QRect visible(screenToWorld(exposed.topLeft()), screenToWorld(exposed.bottomRight()));
+    visible.adjust(-8, -8, 8, 8);
 
     // Рисуем маршруты
     p.setPen(QPen(Qt::black, 2));
-    const auto& routes = m_scene->getRoutes();
-    for (const auto& path : routes)
+    const RoutePaths& routes = m_scene->getRoutes();
+    for (size_t r = 0; r < routes.count(); ++r)
     {
-        for (size_t i = 0; i + 1 < path.size(); ++i)
-            p.drawLine(path[i], path[i + 1]);
+        if (!routes.bounds(r).intersects(visible))
+            continue;
+
+        // Маршрут хранится точками поворота и рисуется одной ломаной
+        RoutePaths::PathView path = routes.path(r);
+        p.drawPolyline(path.data, path.size);
     }
 
     // Рисуем точки
-    auto elements = m_scene->getAllElementsPtr();
-    for (int i = 0; i < static_cast<int>(elements.size()); i++)
+    const std::vector<int>& pointIds = m_scene->getPointIds();
+    const std::vector<QPoint>& positions = m_scene->getPointPositions();
+    for (size_t i = 0; i < positions.size(); i++)
     {
-        Point* point = dynamic_cast<Point*>(elements[i]);
-        if (point) {
-            if (i == m_selectedPoint)
-                p.setBrush(Qt::red);
-            else
-                p.setBrush(Qt::blue);
-
-            p.drawEllipse(point->getPosition(), 5, 5);
-        }
+        if (!visible.contains(positions[i]))
+            continue;
+
+        if (pointIds[i] == m_selectedPoint)
+            p.setBrush(Qt::red);
+        else
+            p.setBrush(Qt::blue);
+
+        p.drawEllipse(positions[i], 5, 5);
     }
 
     // Рисуем временный прямоугольник препятствия
     if (m_creatingObstacle) {
         p.setPen(QPen(QColor(255, 100, 100, 128), 2));
         p.setBrush(QColor(255, 100, 100, 50));
-        QRect rect(m_obstacleStart, m_obstacleEnd);
-        rect = rect.normalized();
-        
-        // Выравниваем прямоугольник по сетке для отображения
-        QPoint topLeft = m_scene->snapToGrid(rect.topLeft());
-        QPoint bottomRight = m_scene->snapToGrid(rect.bottomRight());
-        QRect alignedRect(topLeft, bottomRight);
-        
-        p.drawRect(alignedRect);
+        p.drawRect(obstaclePreviewRect());
     }
 
     p.restore();
+
+    if (m_showStats) {
+        RoutingStats::Snapshot stats = m_scene->getRoutingStats();
+
+        // Перерисовка одного оверлея по таймеру не считается кадром сцены
+        if (!statsOverlayRect().contains(exposed)) {
+            quint64 replans = stats.routesReplanned + stats.routesRepaired;
+            m_frameReplans = replans - m_replansSeen;
+            m_replansSeen = replans;
+            m_frameTimeMs = frameTimer.nsecsElapsed() / 1e6;
+        }
+
+        drawStatsOverlay(p, stats);
+    }
+}
+
+bool GridView::isStaticLayerValid() const
+{
+    return !m_staticLayer.isNull()
+        && m_staticLayer.size() == size() * devicePixelRatioF()
+        && m_staticLayerScale == m_scale
+        && m_staticLayerVersion == m_scene->getObstaclesVersion();
+}
+
+void GridView::renderStaticLayer()
+{
+    m_staticLayer = QPixmap(size() * devicePixelRatioF());
+    m_staticLayer.setDevicePixelRatio(devicePixelRatioF());
+    m_staticLayer.fill(Qt::white);
+    m_staticLayerScale = m_scale;
+    m_staticLayerVersion = m_scene->getObstaclesVersion();
+
+    QPainter p(&m_staticLayer);
+
+    // Рисуем сетку с шагом сцены; слишком частые линии сливаются в фон
+    const double spacing = m_scene->getGridSettings().cellSize * m_scale;
+    if (spacing >= 4) {
+        p.setPen(QPen(Qt::lightGray, 1));
+        for (double x = 0; x < width(); x += spacing)
+            p.drawLine(QPointF(x, 0), QPointF(x, height()));
+
+        for (double y = 0; y < height(); y += spacing)
+            p.drawLine(QPointF(0, y), QPointF(width(), y));
+    }
+
+    p.scale(m_scale, m_scale);
+
+    // Рисуем препятствия
+    p.setPen(Qt::NoPen);
+    p.setBrush(QColor(255, 100, 100));
+    for (const QRect& rect : m_scene->getObstacles())
+        p.drawRect(rect);
+}
+
+QRect GridView::obstaclePreviewRect() const
+{
+    QRect rect(m_obstacleStart, m_obstacleEnd);
+    rect = rect.normalized();
+
+    // Выравниваем прямоугольник по сетке для отображения
+    QPoint topLeft = m_scene->snapToGrid(rect.topLeft());
+    QPoint bottomRight = m_scene->snapToGrid(rect.bottomRight());
+    return QRect(topLeft, bottomRight);
+}
+
+QRect GridView::statsOverlayRect() const
+{
+    const int lines = 4;
+    int lineHeight = fontMetrics().height();
+    return QRect(8, 8, 260, lines * lineHeight + 12);
+}
+
+void GridView::drawStatsOverlay(QPainter &p, const RoutingStats::Snapshot &stats)
+{
+    QRect rect = statsOverlayRect();
+    p.setPen(Qt::NoPen);
+    p.setBrush(QColor(0, 0, 0, 160));
+    p.drawRect(rect);
+
+    QStringList lines;
+    lines << QString("frame %1 ms").arg(m_frameTimeMs, 0, 'f', 2);
+    if (stats.enabled) {
+        lines << QString("replans/frame %1, last rebuild %2").arg(m_frameReplans).arg(stats.lastRebuildRoutes);
+        lines << QString("search p50 %1 us, p99 %2 us").arg(stats.searchTimeP50).arg(stats.searchTimeP99);
+        lines << QString("rebuild p99 %1 us, cached %2").arg(stats.rebuildTimeP99).arg(stats.routesFromCache);
+    } else {
+        lines << QString("routing stats disabled");
+        lines << QString("(build with GRIDVIEW_ENABLE_STATS)");
+    }
+
+    p.setPen(Qt::white);
+    int lineHeight = p.fontMetrics().height();
+    QRect line(rect.left() + 6, rect.top() + 6, rect.width() - 12, lineHeight);
+    for (const QString& text : lines) {
+        p.drawText(line, Qt::AlignLeft | Qt::AlignVCenter, text);
+        line.translate(0, lineHeight);
+    }
 }
 
 void GridView::mousePressEvent(QMouseEvent *e) {
@@ -93,19 +204,7 @@ void GridView::mousePressEvent(QMouseEvent *e) {
 
     if (e->button() == Qt::LeftButton) {
         // Проверяем, кликнули ли мы по существующей точке
-        auto elements = m_scene->getAllElementsPtr();
-        int clickedPointId = -1;
-        
-        for (int i = 0; i < static_cast<int>(elements.size()); i++) {
-            Point* point = dynamic_cast<Point*>(elements[i]);
-            if (point) {
-                QPoint pos = point->getPosition();
-                if (QLineF(worldPos, pos).length() <= 8) {
-                    clickedPointId = point->getId();
-                    break;
-                }
-            }
-        }
+        int clickedPointId = m_scene->pickPoint(worldPos, 8);
         
         if (clickedPointId != -1) {
             if (m_selectedPoint == -1) {
@@ -134,22 +233,24 @@ void GridView::mouseMoveEvent(QMouseEvent *e) {
         QPoint world = screenToWorld(e->pos());
         QPoint newPos = m_scene->snapToGrid(world);
         
+        QPoint oldPos = newPos;
+        m_scene->getPointPosition(m_dragPoint, oldPos);
+
         // Обновляем позицию точки
-        IElement* element = m_scene->getElement(m_dragPoint);
-        Point* point = dynamic_cast<Point*>(element);
-        if (point && !m_scene->isInsideBlockedCell(newPos)) {
-            point->setPosition(newPos);
-            
-            // Перестраиваем все маршруты
-            m_scene->rebuildRoutes();
-            update();
+        if (!m_scene->isInsideBlockedCell(newPos) && m_scene->movePoint(m_dragPoint, newPos)) {
+            // Перестраиваем маршруты, затронутые перемещением, в фоне
+            m_scene->requestRouteRebuild();
+
+            // Перерисовываем только старое и новое положение точки
+            update(worldToScreen(QRect(oldPos, oldPos) | QRect(newPos, newPos)));
         }
     }
     
     // Обновляем конечную точку препятствия
     if (m_creatingObstacle) {
+        QRect oldRect = obstaclePreviewRect();
         m_obstacleEnd = screenToWorld(e->pos());
-        update();
+        update(worldToScreen(oldRect | obstaclePreviewRect()));
     }
 }
 
@@ -173,8 +274,8 @@ void GridView::mouseReleaseEvent(QMouseEvent *e) {
             
             m_scene->addObstacle(alignedRect);
             
-            // Перестраиваем маршруты
-            m_scene->rebuildRoutes();
+            // Перестраиваем маршруты в фоне
+            m_scene->requestRouteRebuild();
         }
         
         update();
@@ -196,6 +297,24 @@ void GridView::keyPressEvent(QKeyEvent *e) {
             m_selectedPoint = -1;
             update();
         }
+    } else if (e->key() == Qt::Key_F3) {
+        // Оверлей статистики маршрутизации
+        m_showStats = !m_showStats;
+        if (m_showStats) {
+            RoutingStats::Snapshot stats = m_scene->getRoutingStats();
+            m_replansSeen = stats.routesReplanned + stats.routesRepaired;
+            m_frameReplans = 0;
+            m_statsTimer.start();
+        } else {
+            m_statsTimer.stop();
+        }
+        update(statsOverlayRect());
+    } else if (e->matches(QKeySequence::Save)) {
+        // Сохраняем сцену вместе с путями маршрутов
+        QString fileName = QFileDialog::getSaveFileName(this, "Save scene", QString(), "Scenes (*.gvs)");
+        QString error;
+        if (!fileName.isEmpty() && !SceneFile::save(*m_scene, fileName, &error))
+            QMessageBox::warning(this, "Save scene", error);
     }
 }
 
@@ -217,4 +336,17 @@ QPoint GridView::screenToWorld(const QPoint &p)
         p.x() / m_scale,
         p.y() / m_scale
     );
+}
+
+QRect GridView::worldToScreen(const QRect &r) const
+{
+    // Запас на толщину линий и радиус точек
+    const int margin = 8;
+    QRect expanded = r.normalized().adjusted(-margin, -margin, margin, margin);
+    return QRect(
+        QPoint(static_cast<int>(std::floor(expanded.left() * m_scale)),
+               static_cast<int>(std::floor(expanded.top() * m_scale))),
+        QPoint(static_cast<int>(std::ceil(expanded.right() * m_scale)),
+               static_cast<int>(std::ceil(expanded.bottom() * m_scale)))
+    );
 }
\ No newline at end of file
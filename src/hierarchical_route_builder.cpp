@@ -0,0 +1,562 @@
+#include "hierarchical_route_builder.h"
+#include <algorithm>
+#include <cstdlib>
+#include <iterator>
+#include <tuple>
+
+namespace {
+
+const QPoint kDirections[] = {
+    QPoint(1, 0),
+    QPoint(-1, 0),
+    QPoint(0, 1),
+    QPoint(0, -1)
+};
+
+// Вход короче этой длины получает один переход посередине, длиннее - два по краям
+const int kLongEntrance = 6;
+
+int manhattan(const QPoint& a, const QPoint& b)
+{
+    return std::abs(a.x() - b.x()) + std::abs(a.y() - b.y());
+}
+
+bool rectLess(const QRect& lhs, const QRect& rhs)
+{
+    return std::make_tuple(lhs.left(), lhs.top(), lhs.right(), lhs.bottom())
+         < std::make_tuple(rhs.left(), rhs.top(), rhs.right(), rhs.bottom());
+}
+
+}
+
+HierarchicalRouteBuilder::HierarchicalRouteBuilder(int clusterSize, int cellSize)
+    : m_clusterSize(std::max(4, clusterSize))
+    , m_cellSize(cellSize)
+    , m_tracksObstacles(false)
+    , m_gridStale(false)
+    , m_blockedExtentStale(true)
+{
+}
+
+std::vector<QPoint> HierarchicalRouteBuilder::buildRoute(
+    const QPoint& start,
+    const QPoint& end,
+    const std::vector<QRect>& obstacles)
+{
+    return buildRouteInternal(start, end, obstacles);
+}
+
+std::vector<std::vector<QPoint>> HierarchicalRouteBuilder::buildRoutes(
+    const std::vector<RouteEndpoints>& endpoints,
+    const std::vector<QRect>& obstacles)
+{
+    // Граф входов общий для всех запросов, поэтому маршруты строятся по одному
+    std::vector<std::vector<QPoint>> paths;
+    paths.reserve(endpoints.size());
+    SearchStats total;
+    total.reached = true;
+
+    for (const RouteEndpoints& ends : endpoints)
+    {
+        paths.push_back(buildRouteInternal(ends.first, ends.second, obstacles));
+
+        total.nodesExpanded += m_stats.nodesExpanded;
+        total.openListPeak = std::max(total.openListPeak, m_stats.openListPeak);
+        total.reached = total.reached && m_stats.reached;
+    }
+
+    m_stats = total;
+    return paths;
+}
+
+void HierarchicalRouteBuilder::obstaclesChanged(const std::vector<QRect>& added, const std::vector<QRect>& removed)
+{
+    // До первого уведомления неизвестно, по какому набору построены кластеры
+    if (!m_tracksObstacles) {
+        clearClusters();
+        m_tracksObstacles = true;
+        m_blockedExtentStale = true;
+    } else {
+        for (const QRect& rc : added) {
+            invalidateAround(rc, m_cellSize);
+            QRect cells = OccupancyGrid::blockedCells(rc, m_cellSize);
+            if (cells.isValid())
+                m_blockedExtent |= cells;
+        }
+        for (const QRect& rc : removed)
+            invalidateAround(rc, m_cellSize);
+        if (!removed.empty())
+            m_blockedExtentStale = true;
+    }
+    m_gridStale = true;
+}
+
+std::unique_ptr<IRouteBuilder> HierarchicalRouteBuilder::clone() const
+{
+    return std::make_unique<HierarchicalRouteBuilder>(m_clusterSize, m_cellSize);
+}
+
+SearchStats HierarchicalRouteBuilder::lastSearchStats() const
+{
+    return m_stats;
+}
+
+std::vector<QPoint> HierarchicalRouteBuilder::buildRouteInternal(
+    const QPoint& a,
+    const QPoint& b,
+    const std::vector<QRect>& obstacles,
+    int maxOffsetMultiplier)
+{
+    const int step = m_cellSize;
+
+    QPoint start = OccupancyGrid::toCell(a, step);
+    QPoint goal = OccupancyGrid::toCell(b, step);
+    m_stats = SearchStats();
+
+    // Для отслеживаемого набора область препятствий известна без обхода набора
+    QRect bounds;
+    if (m_tracksObstacles) {
+        if (m_blockedExtentStale) {
+            m_blockedExtent = OccupancyGrid::blockedExtent(obstacles, step);
+            m_blockedExtentStale = false;
+        }
+        bounds = OccupancyGrid::requiredExtent(m_blockedExtent, start, goal, maxOffsetMultiplier);
+    } else {
+        bounds = OccupancyGrid::requiredExtent(obstacles, step, start, goal, maxOffsetMultiplier);
+    }
+    syncObstacles(obstacles, step, bounds);
+
+    // Если цель недостижима
+    if (m_grid.isBlocked(goal.x(), goal.y()))
+        return { a, b };
+
+    const QPoint startCluster = clusterOf(start);
+    const QPoint goalCluster = clusterOf(goal);
+    const quint64 startKey = key(start);
+    const quint64 goalKey = key(goal);
+
+    // Временные ребра: от старта ко входам его кластера и от входов кластера цели к цели
+    const Cluster& goalData = cluster(goalCluster);
+    searchInCluster(goalCluster, goal);
+    std::unordered_map<quint64, int> toGoal;
+    for (const QPoint& node : goalData.nodes) {
+        int d = localDistance(node);
+        if (d >= 0)
+            toGoal[key(node)] = d;
+    }
+
+    const Cluster& startData = cluster(startCluster);
+    searchInCluster(startCluster, start);
+    std::vector<std::pair<QPoint, int>> fromStart;
+    for (const QPoint& node : startData.nodes) {
+        int d = localDistance(node);
+        if (d >= 0)
+            fromStart.emplace_back(node, d);
+    }
+    int direct = startCluster == goalCluster ? localDistance(goal) : -1;
+
+    // Старт внутри препятствия не попадает в переходы между кластерами:
+    // шаги из него через границу в соседний кластер добавляем отдельно
+    if (m_grid.isBlocked(start.x(), start.y())) {
+        for (const QPoint& d : kDirections)
+        {
+            QPoint nxt = start + d;
+            QPoint nextCluster = clusterOf(nxt);
+            if (nextCluster == startCluster || !isFree(nxt.x(), nxt.y())) continue;
+
+            const Cluster& nextData = cluster(nextCluster);
+            searchInCluster(nextCluster, nxt);
+            for (const QPoint& node : nextData.nodes) {
+                int dist = localDistance(node);
+                if (dist >= 0)
+                    fromStart.emplace_back(node, dist + 1);
+            }
+
+            int toGoalDist = nextCluster == goalCluster ? localDistance(goal) : -1;
+            if (toGoalDist >= 0 && (direct < 0 || toGoalDist + 1 < direct))
+                direct = toGoalDist + 1;
+        }
+    }
+
+    // A* по графу входов
+    auto worse = [](const OpenNode& lhs, const OpenNode& rhs) {
+        if (lhs.f != rhs.f)
+            return lhs.f > rhs.f;
+        return lhs.g < rhs.g;
+    };
+
+    m_states.clear();
+    m_open.clear();
+
+    auto push = [&](const QPoint& cell, int g, quint64 parent) {
+        quint64 k = key(cell);
+        auto it = m_states.find(k);
+        if (it != m_states.end() && it->second.g <= g)
+            return;
+        m_states[k] = { g, parent };
+        m_open.push_back({ g + manhattan(cell, goal), g, k });
+        std::push_heap(m_open.begin(), m_open.end(), worse);
+    };
+
+    push(start, 0, startKey);
+
+    bool found = false;
+    while (!m_open.empty())
+    {
+        std::pop_heap(m_open.begin(), m_open.end(), worse);
+        OpenNode cur = m_open.back();
+        m_open.pop_back();
+
+        if (cur.g > m_states[cur.key].g) continue;
+        if (cur.key == goalKey) {
+            found = true;
+            break;
+        }
+
+        ++m_stats.nodesExpanded;
+
+        QPoint cell = fromKey(cur.key);
+        if (cur.key == startKey) {
+            for (const auto& edge : fromStart)
+                push(edge.first, cur.g + edge.second, cur.key);
+            if (direct >= 0)
+                push(goal, cur.g + direct, cur.key);
+        }
+
+        QPoint clusterCoord = clusterOf(cell);
+        const Cluster& data = cluster(clusterCoord);
+        auto node = data.nodeIndex.find(cur.key);
+        if (node != data.nodeIndex.end()) {
+            const int i = node->second;
+            const int n = static_cast<int>(data.nodes.size());
+
+            for (int j = 0; j < n; ++j) {
+                int d = data.distances[i * n + j];
+                if (j != i && d > 0)
+                    push(data.nodes[j], cur.g + d, cur.key);
+            }
+            for (const QPoint& other : data.links[i])
+                push(other, cur.g + 1, cur.key);
+
+            if (clusterCoord == goalCluster) {
+                auto edge = toGoal.find(cur.key);
+                if (edge != toGoal.end())
+                    push(goal, cur.g + edge->second, cur.key);
+            }
+        }
+
+        m_stats.openListPeak = std::max(m_stats.openListPeak, static_cast<int>(m_open.size()));
+    }
+
+    // Если цель недостижима
+    if (!found)
+        return { a, b };
+
+    m_stats.reached = true;
+
+    std::vector<QPoint> abstractPath;
+    for (quint64 k = goalKey; k != startKey; k = m_states[k].parent)
+        abstractPath.push_back(fromKey(k));
+    abstractPath.push_back(start);
+    std::reverse(abstractPath.begin(), abstractPath.end());
+
+    // Уточнение: отрезки внутри кластера восстанавливаются локальным поиском,
+    // переходы через границу - это один шаг
+    std::vector<QPoint> cells;
+    cells.push_back(start);
+    for (size_t k = 1; k < abstractPath.size(); ++k)
+    {
+        const QPoint& from = abstractPath[k - 1];
+        const QPoint& to = abstractPath[k];
+        if (clusterOf(from) == clusterOf(to)) {
+            appendLocalPath(from, to, cells);
+        } else if (manhattan(from, to) == 1) {
+            cells.push_back(to);
+        } else {
+            // Шаг из старта внутри препятствия в соседний кластер
+            for (const QPoint& d : kDirections) {
+                QPoint via = from + d;
+                if (clusterOf(via) == clusterOf(to)) {
+                    cells.push_back(via);
+                    appendLocalPath(via, to, cells);
+                    break;
+                }
+            }
+        }
+    }
+
+    std::vector<QPoint> pathGrid;
+    pathGrid.reserve(cells.size());
+    for (const QPoint& c : cells)
+        pathGrid.push_back(QPoint(c.x() * step, c.y() * step));
+    return pathGrid;
+}
+
+void HierarchicalRouteBuilder::syncObstacles(const std::vector<QRect>& obstacles, int step, const QRect& bounds)
+{
+    // Карта выравнивается по кластерам, чтобы кластеры не меняли форму при ее расширении
+    const int size = m_clusterSize;
+    QRect area(QPoint(OccupancyGrid::toCell(bounds.left(), size) * size,
+                      OccupancyGrid::toCell(bounds.top(), size) * size),
+               QPoint((OccupancyGrid::toCell(bounds.right(), size) + 1) * size - 1,
+                      (OccupancyGrid::toCell(bounds.bottom(), size) + 1) * size - 1));
+
+    // Отслеживаемый набор не сравнивается: изменения приходят уведомлениями
+    const bool sameStep = m_grid.step() == step;
+    const bool sameObstacles = sameStep
+        && (m_tracksObstacles ? !m_gridStale : m_grid.obstacles() == obstacles);
+    if (sameObstacles && m_grid.cellExtent().contains(area))
+        return;
+
+    // Область карты только растет
+    QRect extent = area;
+    if (sameStep)
+        extent |= m_grid.cellExtent();
+
+    if (!sameStep) {
+        clearClusters();
+    } else {
+        if (!sameObstacles && !m_tracksObstacles) {
+            // Сбрасываем только кластеры рядом с добавленными и удаленными препятствиями
+            std::vector<QRect> before = m_grid.obstacles();
+            std::vector<QRect> after = obstacles;
+            std::sort(before.begin(), before.end(), rectLess);
+            std::sort(after.begin(), after.end(), rectLess);
+
+            std::vector<QRect> changed;
+            std::set_symmetric_difference(before.begin(), before.end(), after.begin(), after.end(),
+                                          std::back_inserter(changed), rectLess);
+            for (const QRect& rc : changed)
+                invalidateAround(rc, step);
+        }
+        invalidateBorders(m_grid.cellExtent(), extent);
+    }
+
+    m_grid.build(obstacles, step, extent);
+    m_gridStale = false;
+}
+
+void HierarchicalRouteBuilder::invalidateAround(const QRect& obstacle, int step)
+{
+    // Запас в один узел: изменение на границе кластера меняет и входы соседа
+    QRect r = obstacle.normalized();
+    invalidateClusters(QRect(
+        QPoint(OccupancyGrid::toCell(r.left(), step) - 1, OccupancyGrid::toCell(r.top(), step) - 1),
+        QPoint(OccupancyGrid::toCell(r.right(), step) + 1, OccupancyGrid::toCell(r.bottom(), step) + 1)));
+}
+
+void HierarchicalRouteBuilder::invalidateBorders(const QRect& before, const QRect& after)
+{
+    if (!before.isValid() || before == after)
+        return;
+
+    // За старой границей узлы считались заблокированными: у кластеров вдоль
+    // расширенной стороны могут появиться входы. Остальные кластеры не меняются
+    if (after.left() < before.left())
+        invalidateClusters(QRect(before.left(), before.top(), 1, before.height()));
+    if (after.right() > before.right())
+        invalidateClusters(QRect(before.right(), before.top(), 1, before.height()));
+    if (after.top() < before.top())
+        invalidateClusters(QRect(before.left(), before.top(), before.width(), 1));
+    if (after.bottom() > before.bottom())
+        invalidateClusters(QRect(before.left(), before.bottom(), before.width(), 1));
+}
+
+void HierarchicalRouteBuilder::invalidateClusters(const QRect& cellArea)
+{
+    QPoint first = clusterOf(cellArea.topLeft());
+    QPoint last = clusterOf(cellArea.bottomRight());
+
+    for (int cy = first.y(); cy <= last.y(); ++cy)
+    {
+        for (int cx = first.x(); cx <= last.x(); ++cx)
+        {
+            m_clusters.erase(key(cx, cy));
+
+            // Границы хранятся у левого и верхнего кластера пары
+            m_borders[0].erase(key(cx, cy));
+            m_borders[1].erase(key(cx, cy));
+            m_borders[0].erase(key(cx - 1, cy));
+            m_borders[1].erase(key(cx, cy - 1));
+        }
+    }
+}
+
+void HierarchicalRouteBuilder::clearClusters()
+{
+    m_clusters.clear();
+    m_borders[0].clear();
+    m_borders[1].clear();
+}
+
+QPoint HierarchicalRouteBuilder::clusterOf(const QPoint& cell) const
+{
+    return OccupancyGrid::toCell(cell, m_clusterSize);
+}
+
+QRect HierarchicalRouteBuilder::clusterCells(const QPoint& cluster) const
+{
+    return QRect(cluster.x() * m_clusterSize, cluster.y() * m_clusterSize, m_clusterSize, m_clusterSize);
+}
+
+bool HierarchicalRouteBuilder::isFree(int gx, int gy) const
+{
+    // Узлы за пределами карты заблокированы
+    return !m_grid.isBlocked(gx, gy);
+}
+
+const std::vector<HierarchicalRouteBuilder::Transition>& HierarchicalRouteBuilder::border(
+    const QPoint& owner, bool vertical)
+{
+    std::unordered_map<quint64, std::vector<Transition>>& cache = m_borders[vertical ? 0 : 1];
+    auto it = cache.find(key(owner));
+    if (it != cache.end())
+        return it->second;
+
+    // Вдоль границы идут узлы крайнего столбца (строки) владельца и соседние за границей
+    const QRect cells = clusterCells(owner);
+    const QPoint across = vertical ? QPoint(1, 0) : QPoint(0, 1);
+    auto side = [&](int i) {
+        return vertical ? QPoint(cells.right(), cells.top() + i) : QPoint(cells.left() + i, cells.bottom());
+    };
+    auto isOpen = [&](int i) {
+        QPoint a = side(i);
+        QPoint b = a + across;
+        return isFree(a.x(), a.y()) && isFree(b.x(), b.y());
+    };
+
+    std::vector<Transition> transitions;
+    int i = 0;
+    while (i < m_clusterSize)
+    {
+        if (!isOpen(i)) {
+            ++i;
+            continue;
+        }
+
+        int begin = i;
+        while (i < m_clusterSize && isOpen(i))
+            ++i;
+        int end = i - 1;
+
+        if (end - begin + 1 < kLongEntrance) {
+            QPoint mid = side((begin + end) / 2);
+            transitions.emplace_back(mid, mid + across);
+        } else {
+            transitions.emplace_back(side(begin), side(begin) + across);
+            transitions.emplace_back(side(end), side(end) + across);
+        }
+    }
+
+    return cache.emplace(key(owner), std::move(transitions)).first->second;
+}
+
+const HierarchicalRouteBuilder::Cluster& HierarchicalRouteBuilder::cluster(const QPoint& coord)
+{
+    auto it = m_clusters.find(key(coord));
+    if (it != m_clusters.end())
+        return it->second;
+
+    Cluster data;
+    auto addNode = [&data](const QPoint& cell, const QPoint& other) {
+        auto node = data.nodeIndex.emplace(key(cell), static_cast<int>(data.nodes.size())).first;
+        if (node->second == static_cast<int>(data.nodes.size())) {
+            data.nodes.push_back(cell);
+            data.links.emplace_back();
+        }
+        data.links[node->second].push_back(other);
+    };
+
+    for (const Transition& t : border(coord, true))
+        addNode(t.first, t.second);
+    for (const Transition& t : border(coord, false))
+        addNode(t.first, t.second);
+    for (const Transition& t : border(coord - QPoint(1, 0), true))
+        addNode(t.second, t.first);
+    for (const Transition& t : border(coord - QPoint(0, 1), false))
+        addNode(t.second, t.first);
+
+    // Расстояния между входами внутри кластера
+    const int n = static_cast<int>(data.nodes.size());
+    data.distances.assign(static_cast<size_t>(n) * n, -1);
+    for (int i = 0; i < n; ++i) {
+        searchInCluster(coord, data.nodes[i]);
+        for (int j = 0; j < n; ++j)
+            data.distances[i * n + j] = localDistance(data.nodes[j]);
+    }
+
+    return m_clusters.emplace(key(coord), std::move(data)).first->second;
+}
+
+void HierarchicalRouteBuilder::searchInCluster(const QPoint& clusterCoord, const QPoint& from)
+{
+    const int size = m_clusterSize;
+    m_localArea = clusterCells(clusterCoord);
+    m_localWorkspace.reset(size * size);
+    std::vector<int>& queue = m_localWorkspace.queue();
+
+    auto local = [this, size](const QPoint& c) {
+        return (c.y() - m_localArea.top()) * size + (c.x() - m_localArea.left());
+    };
+
+    // Старт может лежать внутри препятствия: из него выходим, но не входим
+    int origin = local(from);
+    m_localWorkspace.visit(origin, 0, origin);
+    queue.push_back(origin);
+
+    for (size_t head = 0; head < queue.size(); ++head)
+    {
+        int current = queue[head];
+        QPoint cell(m_localArea.left() + current % size, m_localArea.top() + current / size);
+        ++m_stats.nodesExpanded;
+
+        for (const QPoint& d : kDirections)
+        {
+            QPoint nxt = cell + d;
+            if (!m_localArea.contains(nxt) || !isFree(nxt.x(), nxt.y())) continue;
+
+            int index = local(nxt);
+            if (m_localWorkspace.isVisited(index)) continue;
+
+            m_localWorkspace.visit(index, m_localWorkspace.cost(current) + 1, current);
+            queue.push_back(index);
+        }
+    }
+}
+
+int HierarchicalRouteBuilder::localDistance(const QPoint& cell) const
+{
+    if (!m_localArea.contains(cell))
+        return -1;
+    int index = (cell.y() - m_localArea.top()) * m_clusterSize + (cell.x() - m_localArea.left());
+    return m_localWorkspace.isVisited(index) ? m_localWorkspace.cost(index) : -1;
+}
+
+void HierarchicalRouteBuilder::appendLocalPath(const QPoint& from, const QPoint& to, std::vector<QPoint>& cells)
+{
+    searchInCluster(clusterOf(from), from);
+
+    const int size = m_clusterSize;
+    int origin = (from.y() - m_localArea.top()) * size + (from.x() - m_localArea.left());
+    int p = (to.y() - m_localArea.top()) * size + (to.x() - m_localArea.left());
+
+    size_t first = cells.size();
+    for (; p != origin; p = m_localWorkspace.parent(p))
+        cells.push_back(QPoint(m_localArea.left() + p % size, m_localArea.top() + p / size));
+    std::reverse(cells.begin() + first, cells.end());
+}
+
+quint64 HierarchicalRouteBuilder::key(int x, int y)
+{
+    return (static_cast<quint64>(static_cast<quint32>(x)) << 32) | static_cast<quint32>(y);
+}
+
+quint64 HierarchicalRouteBuilder::key(const QPoint& p)
+{
+    return key(p.x(), p.y());
+}
+
+QPoint HierarchicalRouteBuilder::fromKey(quint64 k)
+{
+    return QPoint(static_cast<qint32>(k >> 32), static_cast<qint32>(k & 0xffffffffu));
+}
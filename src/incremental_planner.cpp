@@ -0,0 +1,266 @@
+#include "incremental_planner.h"
+#include <algorithm>
+#include <limits>
+
+namespace {
+
+const int kInfinity = std::numeric_limits<int>::max() / 2;
+
+// Запас области вокруг препятствий и концов маршрута, чтобы перемещение
+// конца не приводило к перестроению дерева на каждом шаге
+const int kExtentSlack = 10;
+
+}
+
+IncrementalPlanner::IncrementalPlanner(int step)
+    : m_step(step)
+    , m_rootIndex(-1)
+    , m_valid(false)
+    , m_markStamp(0)
+{
+}
+
+bool IncrementalPlanner::plan(const QPoint& start,
+                              const QPoint& end,
+                              const std::vector<QRect>& obstacles,
+                              std::vector<QPoint>& path)
+{
+    QPoint startCell = OccupancyGrid::toCell(start, m_step);
+    QPoint endCell = OccupancyGrid::toCell(end, m_step);
+
+    QRect required = OccupancyGrid::requiredExtent(obstacles, m_step, startCell, endCell, 1);
+    bool reusable = m_valid
+        && m_grid.cellExtent().contains(required)
+        && (m_rootCell == startCell || m_rootCell == endCell);
+
+    if (!reusable) {
+        // Корнем становится конец, который не двигался с прошлого вызова
+        QPoint root = startCell;
+        if (m_valid && endCell == m_lastEndCell && startCell != m_lastStartCell)
+            root = endCell;
+        QRect extent = OccupancyGrid::requiredExtent(obstacles, m_step, startCell, endCell, kExtentSlack);
+        reset(root, obstacles, extent);
+    } else if (m_grid.obstacles() != obstacles) {
+        applyObstacleChanges(obstacles);
+    }
+
+    m_lastStartCell = startCell;
+    m_lastEndCell = endCell;
+
+    bool forward = (m_rootCell == startCell);
+    QPoint targetCell = forward ? endCell : startCell;
+
+    // Начальный узел внутри препятствия допустим только как корень дерева
+    if (!forward && m_grid.isBlocked(startCell.x(), startCell.y()))
+        return false;
+
+    // Если цель недостижима
+    if (m_grid.isBlocked(endCell.x(), endCell.y())) {
+        path = { start, end };
+        return true;
+    }
+
+    int target = m_grid.indexOf(targetCell.x(), targetCell.y());
+    computeShortestPath(target);
+
+    if (m_g[target] >= kInfinity) {
+        path = { start, end };
+        return true;
+    }
+
+    // Путь выбирается по правилу RouteBuilder::extractPath: от конца к началу
+    // через первого по порядку направлений соседа, который на 1 ближе к началу.
+    // Поэтому починенный маршрут совпадает с построенным заново, а не только
+    // равен ему по длине
+    const int startIndex = forward ? m_rootIndex : target;
+    const int endIndex = forward ? target : m_rootIndex;
+    if (!forward)
+        markShortestPaths(startIndex);
+
+    path.clear();
+    path.reserve(m_g[target] + 1);
+
+    int cur = endIndex;
+    int adj[4];
+    while (true) {
+        QPoint c = m_grid.cellAt(cur);
+        path.push_back(QPoint(c.x() * m_step, c.y() * m_step));
+        if (cur == startIndex)
+            break;
+
+        int count = neighbors(cur, adj);
+        int next = -1;
+        for (int i = 0; i < count; ++i) {
+            if (isCloserToStart(adj[i], cur, forward)) {
+                next = adj[i];
+                break;
+            }
+        }
+        if (next == -1) {
+            m_valid = false;
+            return false;
+        }
+        cur = next;
+    }
+
+    std::reverse(path.begin(), path.end());
+    return true;
+}
+
+void IncrementalPlanner::reset(const QPoint& rootCell, const std::vector<QRect>& obstacles, const QRect& extent)
+{
+    m_grid.build(obstacles, m_step, extent);
+    m_g.assign(m_grid.cellCount(), kInfinity);
+    m_rhs.assign(m_grid.cellCount(), kInfinity);
+    m_queue.clear();
+    m_marks.assign(m_grid.cellCount(), 0);
+    m_markStamp = 0;
+
+    m_rootCell = rootCell;
+    m_rootIndex = m_grid.indexOf(rootCell.x(), rootCell.y());
+    m_rhs[m_rootIndex] = 0;
+    push(m_rootIndex);
+    m_valid = true;
+}
+
+void IncrementalPlanner::applyObstacleChanges(const std::vector<QRect>& obstacles)
+{
+    OccupancyGrid previous = m_grid;
+    m_grid.build(obstacles, m_step, previous.cellExtent());
+
+    int adj[4];
+    for (int i = 0; i < m_grid.cellCount(); ++i) {
+        if (m_grid.isBlockedIndex(i) == previous.isBlockedIndex(i))
+            continue;
+
+        updateVertex(i);
+        int count = neighbors(i, adj);
+        for (int k = 0; k < count; ++k)
+            updateVertex(adj[k]);
+    }
+}
+
+void IncrementalPlanner::updateVertex(int index)
+{
+    if (index != m_rootIndex) {
+        int best = kInfinity;
+        if (!m_grid.isBlockedIndex(index)) {
+            int adj[4];
+            int count = neighbors(index, adj);
+            for (int k = 0; k < count; ++k) {
+                if (!isPassable(adj[k]))
+                    continue;
+                best = std::min(best, m_g[adj[k]] + 1);
+            }
+        }
+        m_rhs[index] = best;
+    }
+
+    if (m_g[index] != m_rhs[index])
+        push(index);
+}
+
+void IncrementalPlanner::computeShortestPath(int targetIndex)
+{
+    int adj[4];
+    while (!m_queue.empty()
+           && (m_queue.front().key < key(targetIndex) || m_rhs[targetIndex] != m_g[targetIndex]))
+    {
+        std::pop_heap(m_queue.begin(), m_queue.end(), laterEntry);
+        QueueEntry top = m_queue.back();
+        m_queue.pop_back();
+
+        int u = top.index;
+        // Устаревшие записи очереди пропускаем
+        if (m_g[u] == m_rhs[u] || top.key != key(u))
+            continue;
+
+        int count = neighbors(u, adj);
+        if (m_g[u] > m_rhs[u]) {
+            m_g[u] = m_rhs[u];
+        } else {
+            m_g[u] = kInfinity;
+            updateVertex(u);
+        }
+        for (int k = 0; k < count; ++k)
+            updateVertex(adj[k]);
+    }
+}
+
+void IncrementalPlanner::markShortestPaths(int startIndex)
+{
+    // Метки не сбрасываются между вызовами: новый вызов - новое значение
+    if (++m_markStamp == 0) {
+        std::fill(m_marks.begin(), m_marks.end(), 0);
+        m_markStamp = 1;
+    }
+
+    // Узлы кратчайших путей - те, куда от начала можно спуститься по g на 1
+    // за шаг; только для них расстояние от начала равно g[start] - g
+    m_pending.clear();
+    m_pending.push_back(startIndex);
+    m_marks[startIndex] = m_markStamp;
+
+    int adj[4];
+    while (!m_pending.empty()) {
+        int u = m_pending.back();
+        m_pending.pop_back();
+
+        int count = neighbors(u, adj);
+        for (int k = 0; k < count; ++k) {
+            int v = adj[k];
+            if (m_marks[v] != m_markStamp && isPassable(v) && m_g[v] == m_g[u] - 1) {
+                m_marks[v] = m_markStamp;
+                m_pending.push_back(v);
+            }
+        }
+    }
+}
+
+bool IncrementalPlanner::isCloserToStart(int index, int from, bool forward) const
+{
+    if (!isPassable(index))
+        return false;
+
+    // Дерево от начала: g и есть расстояние от него. Дерево от конца: сосед
+    // дальше от конца и лежит на кратчайшем пути
+    if (forward)
+        return m_g[index] == m_g[from] - 1;
+    return m_g[index] == m_g[from] + 1 && m_marks[index] == m_markStamp;
+}
+
+int IncrementalPlanner::neighbors(int index, int* out) const
+{
+    QPoint c = m_grid.cellAt(index);
+    QRect extent = m_grid.cellExtent();
+    int count = 0;
+
+    if (c.x() < extent.right()) out[count++] = index + 1;
+    if (c.x() > extent.left()) out[count++] = index - 1;
+    if (c.y() < extent.bottom()) out[count++] = index + m_grid.width();
+    if (c.y() > extent.top()) out[count++] = index - m_grid.width();
+
+    return count;
+}
+
+int IncrementalPlanner::key(int index) const
+{
+    return std::min(m_g[index], m_rhs[index]);
+}
+
+void IncrementalPlanner::push(int index)
+{
+    m_queue.push_back({ key(index), index });
+    std::push_heap(m_queue.begin(), m_queue.end(), laterEntry);
+}
+
+bool IncrementalPlanner::laterEntry(const QueueEntry& lhs, const QueueEntry& rhs)
+{
+    return lhs.key > rhs.key;
+}
+
+bool IncrementalPlanner::isPassable(int index) const
+{
+    // Корень может оказаться внутри препятствия: из него разрешено выйти
+    return index == m_rootIndex || !m_grid.isBlockedIndex(index);
+}
@@ -0,0 +1,55 @@
+#include "instrumented_route_builder.h"
+#include <QElapsedTimer>
+
+InstrumentedRouteBuilder::InstrumentedRouteBuilder(std::unique_ptr<IRouteBuilder> builder, RoutingStats* stats)
+    : m_builder(std::move(builder))
+    , m_stats(stats)
+{
+}
+
+std::vector<QPoint> InstrumentedRouteBuilder::buildRoute(
+    const QPoint& start,
+    const QPoint& end,
+    const std::vector<QRect>& obstacles)
+{
+    QElapsedTimer timer;
+    timer.start();
+    std::vector<QPoint> path = m_builder->buildRoute(start, end, obstacles);
+    quint64 micros = static_cast<quint64>(timer.nsecsElapsed() / 1000);
+
+    m_stats->recordSearch(m_builder->lastSearchStats(), 1, path.size(), micros);
+    return path;
+}
+
+std::vector<std::vector<QPoint>> InstrumentedRouteBuilder::buildRoutes(
+    const std::vector<RouteEndpoints>& endpoints,
+    const std::vector<QRect>& obstacles)
+{
+    QElapsedTimer timer;
+    timer.start();
+    std::vector<std::vector<QPoint>> paths = m_builder->buildRoutes(endpoints, obstacles);
+    quint64 micros = static_cast<quint64>(timer.nsecsElapsed() / 1000);
+
+    // Пакет записывается одним поиском: его маршруты строятся совместно,
+    // а в гистограмму времени попадает среднее время маршрута
+    quint64 pathPoints = 0;
+    for (const auto& path : paths)
+        pathPoints += path.size();
+    m_stats->recordSearch(m_builder->lastSearchStats(), static_cast<int>(paths.size()), pathPoints, micros);
+    return paths;
+}
+
+void InstrumentedRouteBuilder::obstaclesChanged(const std::vector<QRect>& added, const std::vector<QRect>& removed)
+{
+    m_builder->obstaclesChanged(added, removed);
+}
+
+std::unique_ptr<IRouteBuilder> InstrumentedRouteBuilder::clone() const
+{
+    return std::make_unique<InstrumentedRouteBuilder>(m_builder->clone(), m_stats);
+}
+
+SearchStats InstrumentedRouteBuilder::lastSearchStats() const
+{
+    return m_builder->lastSearchStats();
+}
@@ -0,0 +1,332 @@
+#include "jps_route_builder.h"
+#include <algorithm>
+#include <cstdlib>
+
+namespace {
+
+const QPoint kDirections[] = {
+    QPoint(1, 0),
+    QPoint(-1, 0),
+    QPoint(0, 1),
+    QPoint(0, -1)
+};
+
+int manhattan(const QPoint& a, const QPoint& b)
+{
+    return std::abs(a.x() - b.x()) + std::abs(a.y() - b.y());
+}
+
+}
+
+JpsRouteBuilder::JpsRouteBuilder(bool useJumpTables, int cellSize)
+    : m_useJumpTables(useJumpTables)
+    , m_cellSize(cellSize)
+    , m_jumpTablesValid(false)
+{
+}
+
+std::vector<QPoint> JpsRouteBuilder::buildRoute(
+    const QPoint& start,
+    const QPoint& end,
+    const std::vector<QRect>& obstacles)
+{
+    return buildRouteInternal(start, end, obstacles);
+}
+
+std::vector<std::vector<QPoint>> JpsRouteBuilder::buildRoutes(
+    const std::vector<RouteEndpoints>& endpoints,
+    const std::vector<QRect>& obstacles)
+{
+    // Поиск с прыжками направлен на одну цель, поэтому маршруты строятся по одному
+    std::vector<std::vector<QPoint>> paths;
+    paths.reserve(endpoints.size());
+    SearchStats total;
+    total.reached = true;
+
+    for (const RouteEndpoints& ends : endpoints)
+    {
+        paths.push_back(buildRouteInternal(ends.first, ends.second, obstacles));
+
+        total.nodesExpanded += m_stats.nodesExpanded;
+        total.openListPeak = std::max(total.openListPeak, m_stats.openListPeak);
+        total.reached = total.reached && m_stats.reached;
+    }
+
+    m_stats = total;
+    return paths;
+}
+
+std::unique_ptr<IRouteBuilder> JpsRouteBuilder::clone() const
+{
+    return std::make_unique<JpsRouteBuilder>(m_useJumpTables, m_cellSize);
+}
+
+SearchStats JpsRouteBuilder::lastSearchStats() const
+{
+    return m_stats;
+}
+
+std::vector<QPoint> JpsRouteBuilder::buildRouteInternal(
+    const QPoint& a,
+    const QPoint& b,
+    const std::vector<QRect>& obstacles,
+    int maxOffsetMultiplier)
+{
+    const int step = m_cellSize;
+
+    QPoint start = OccupancyGrid::toCell(a, step);
+    QPoint goal = OccupancyGrid::toCell(b, step);
+    m_stats = SearchStats();
+
+    // Та же область поиска, что и у RouteBuilder: длины путей совпадают
+    QRect bounds = OccupancyGrid::requiredExtent(obstacles, step, start, goal, maxOffsetMultiplier);
+    if (m_grid.ensure(obstacles, step, bounds))
+        m_jumpTablesValid = false;
+
+    // Таблицы прыжков покрывают всю карту; за пределами bounds кратчайший путь
+    // не становится короче, так как запас области не меньше одного узла
+    if (m_useJumpTables) {
+        m_area = m_grid.cellExtent();
+        if (!m_jumpTablesValid)
+            buildJumpTables();
+    } else {
+        m_area = bounds;
+    }
+
+    // Если цель недостижима
+    if (m_grid.isBlocked(goal.x(), goal.y()))
+        return { a, b };
+
+    const int cellCount = m_grid.cellCount();
+    const int startIndex = m_grid.indexOf(start.x(), start.y());
+    const int goalIndex = m_grid.indexOf(goal.x(), goal.y());
+
+    m_workspace.reset(cellCount);
+    std::vector<OpenNode>& open = m_workspace.open();
+
+    // Меньшее f выше; при равных f предпочитаем более глубокие узлы
+    auto worse = [](const OpenNode& lhs, const OpenNode& rhs) {
+        if (lhs.f != rhs.f)
+            return lhs.f > rhs.f;
+        return lhs.g < rhs.g;
+    };
+
+    m_workspace.visit(startIndex, 0, startIndex);
+    open.push_back({ manhattan(start, goal), 0, startIndex });
+
+    while (!open.empty())
+    {
+        std::pop_heap(open.begin(), open.end(), worse);
+        OpenNode cur = open.back();
+        open.pop_back();
+
+        if (cur.g > m_workspace.cost(cur.index)) continue;
+        if (cur.index == goalIndex)
+            break;
+
+        ++m_stats.nodesExpanded;
+
+        QPoint cell = m_grid.cellAt(cur.index);
+        QPoint from = m_grid.cellAt(m_workspace.parent(cur.index));
+
+        // Направления, в которых может продолжиться кратчайший путь:
+        // из старта - все; после горизонтального шага - вперед и по вертикали;
+        // после вертикального - вперед и по горизонтали
+        Direction candidates[DirectionCount];
+        int candidateCount = 0;
+        if (cur.index == startIndex) {
+            for (int d = 0; d < DirectionCount; ++d)
+                candidates[candidateCount++] = static_cast<Direction>(d);
+        } else if (from.y() == cell.y()) {
+            candidates[candidateCount++] = cell.x() > from.x() ? Right : Left;
+            candidates[candidateCount++] = Down;
+            candidates[candidateCount++] = Up;
+        } else {
+            candidates[candidateCount++] = cell.y() > from.y() ? Down : Up;
+            candidates[candidateCount++] = Right;
+            candidates[candidateCount++] = Left;
+        }
+
+        for (int i = 0; i < candidateCount; ++i)
+        {
+            int index = jump(cell, candidates[i], goal);
+            if (index == -1) continue;
+
+            QPoint nxt = m_grid.cellAt(index);
+            int g = cur.g + manhattan(cell, nxt);
+            if (g >= m_workspace.cost(index)) continue;
+
+            m_workspace.visit(index, g, cur.index);
+            open.push_back({ g + manhattan(nxt, goal), g, index });
+            std::push_heap(open.begin(), open.end(), worse);
+        }
+
+        m_stats.openListPeak = std::max(m_stats.openListPeak, static_cast<int>(open.size()));
+    }
+
+    // Если цель недостижима
+    if (!m_workspace.isVisited(goalIndex))
+        return { a, b };
+
+    m_stats.reached = true;
+    return extractPath(startIndex, goalIndex, step);
+}
+
+bool JpsRouteBuilder::isWalkable(int gx, int gy) const
+{
+    return m_area.contains(QPoint(gx, gy)) && !m_grid.isBlocked(gx, gy);
+}
+
+int JpsRouteBuilder::jump(const QPoint& cell, Direction dir, const QPoint& goal) const
+{
+    if (m_useJumpTables)
+        return jumpWithTables(cell, dir, goal);
+
+    const QPoint& d = kDirections[dir];
+    if (d.y() == 0)
+        return jumpHorizontal(cell.x(), cell.y(), d.x(), goal);
+    return jumpVertical(cell.x(), cell.y(), d.y(), goal);
+}
+
+bool JpsRouteBuilder::isForcedHorizontal(int gx, int gy, int dx) const
+{
+    // Сверху или снизу открылся проход, закрытый у предыдущего узла
+    return (isWalkable(gx, gy - 1) && !isWalkable(gx - dx, gy - 1))
+        || (isWalkable(gx, gy + 1) && !isWalkable(gx - dx, gy + 1));
+}
+
+bool JpsRouteBuilder::isForcedVertical(int gx, int gy, int dy) const
+{
+    return (isWalkable(gx - 1, gy) && !isWalkable(gx - 1, gy - dy))
+        || (isWalkable(gx + 1, gy) && !isWalkable(gx + 1, gy - dy));
+}
+
+int JpsRouteBuilder::jumpHorizontal(int gx, int gy, int dx, const QPoint& goal) const
+{
+    while (true)
+    {
+        gx += dx;
+        if (!isWalkable(gx, gy))
+            return -1;
+
+        if ((gx == goal.x() && gy == goal.y()) || isForcedHorizontal(gx, gy, dx))
+            return m_grid.indexOf(gx, gy);
+    }
+}
+
+int JpsRouteBuilder::jumpVertical(int gx, int gy, int dy, const QPoint& goal) const
+{
+    while (true)
+    {
+        gy += dy;
+        if (!isWalkable(gx, gy))
+            return -1;
+
+        if ((gx == goal.x() && gy == goal.y()) || isForcedVertical(gx, gy, dy))
+            return m_grid.indexOf(gx, gy);
+
+        // Вертикальный прыжок останавливается там, где есть смысл свернуть
+        if (jumpHorizontal(gx, gy, 1, goal) != -1 || jumpHorizontal(gx, gy, -1, goal) != -1)
+            return m_grid.indexOf(gx, gy);
+    }
+}
+
+int JpsRouteBuilder::jumpWithTables(const QPoint& cell, Direction dir, const QPoint& goal) const
+{
+    const QPoint& d = kDirections[dir];
+    int distance = m_jumpTable[dir][m_grid.indexOf(cell.x(), cell.y())];
+    int reach = distance > 0 ? distance : -distance;
+
+    // Цель не хранится в таблицах: проверяем, не лежит ли она на пути прыжка
+    if (d.y() == 0) {
+        int along = (goal.x() - cell.x()) * d.x();
+        if (goal.y() == cell.y() && along > 0 && along <= reach)
+            return m_grid.indexOf(goal.x(), goal.y());
+    } else {
+        // На строке цели горизонтальный прыжок может дойти до нее
+        int along = (goal.y() - cell.y()) * d.y();
+        if (along > 0 && along <= reach)
+            return m_grid.indexOf(cell.x(), goal.y());
+    }
+
+    if (distance <= 0)
+        return -1;
+    return m_grid.indexOf(cell.x() + d.x() * distance, cell.y() + d.y() * distance);
+}
+
+void JpsRouteBuilder::buildJumpTables()
+{
+    const QRect extent = m_grid.cellExtent();
+    for (std::vector<int>& table : m_jumpTable)
+        table.assign(m_grid.cellCount(), 0);
+
+    // Значение узла выводится из значения следующего узла по направлению,
+    // поэтому строки и столбцы обходятся навстречу направлению
+    auto fill = [this](Direction dir, int gx, int gy, bool isJumpPoint) {
+        const QPoint& d = kDirections[dir];
+        int nx = gx + d.x();
+        int ny = gy + d.y();
+
+        int value = 0;
+        if (!isWalkable(nx, ny)) {
+            value = 0;
+        } else if (isJumpPoint) {
+            value = 1;
+        } else {
+            int next = m_jumpTable[dir][m_grid.indexOf(nx, ny)];
+            value = next > 0 ? next + 1 : next - 1;
+        }
+        m_jumpTable[dir][m_grid.indexOf(gx, gy)] = value;
+    };
+
+    for (int gy = extent.top(); gy <= extent.bottom(); ++gy)
+    {
+        for (int gx = extent.right(); gx >= extent.left(); --gx)
+            fill(Right, gx, gy, isForcedHorizontal(gx + 1, gy, 1));
+        for (int gx = extent.left(); gx <= extent.right(); ++gx)
+            fill(Left, gx, gy, isForcedHorizontal(gx - 1, gy, -1));
+    }
+
+    // Вертикальный прыжок останавливается и там, где останавливается горизонтальный
+    auto isVerticalJumpPoint = [this](int gx, int gy, int dy) {
+        if (!m_grid.contains(gx, gy))
+            return false;
+        int index = m_grid.indexOf(gx, gy);
+        return isForcedVertical(gx, gy, dy)
+            || m_jumpTable[Right][index] > 0
+            || m_jumpTable[Left][index] > 0;
+    };
+
+    for (int gx = extent.left(); gx <= extent.right(); ++gx)
+    {
+        for (int gy = extent.bottom(); gy >= extent.top(); --gy)
+            fill(Down, gx, gy, isVerticalJumpPoint(gx, gy + 1, 1));
+        for (int gy = extent.top(); gy <= extent.bottom(); ++gy)
+            fill(Up, gx, gy, isVerticalJumpPoint(gx, gy - 1, -1));
+    }
+
+    m_jumpTablesValid = true;
+}
+
+std::vector<QPoint> JpsRouteBuilder::extractPath(int startIndex, int goalIndex, int step) const
+{
+    // Между соседними точками прыжка путь прямой: восстанавливаем все узлы
+    std::vector<QPoint> pathGrid;
+    pathGrid.reserve(m_workspace.cost(goalIndex) + 1);
+
+    int p = goalIndex;
+    while (p != startIndex) {
+        QPoint c = m_grid.cellAt(p);
+        QPoint prev = m_grid.cellAt(m_workspace.parent(p));
+        QPoint d((prev.x() > c.x()) - (prev.x() < c.x()), (prev.y() > c.y()) - (prev.y() < c.y()));
+
+        for (; c != prev; c += d)
+            pathGrid.push_back(QPoint(c.x() * step, c.y() * step));
+        p = m_workspace.parent(p);
+    }
+    QPoint s = m_grid.cellAt(startIndex);
+    pathGrid.push_back(QPoint(s.x() * step, s.y() * step));
+
+    std::reverse(pathGrid.begin(), pathGrid.end());
+    return pathGrid;
+}
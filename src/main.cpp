@@ -1,7 +1,10 @@
 #include <QApplication>
 #include "grid_view.h"
 #include "scene_factory.h"
+#include "scene_file.h"
+#include "scene_stream.h"
 #include "i_scene.h"
+#include <QtGlobal>
 #include <memory>
 
 int main(int argc, char *argv[]) {
@@ -10,6 +13,18 @@ int main(int argc, char *argv[]) {
     // Создаем сцену через фабрику
     std::unique_ptr<IScene> scene = SceneFactory::createScene();
     
+    // Сцена из файла, переданного первым аргументом: двоичный файл сцены
+    // или список точек и препятствий в CSV/JSON
+    if (argc > 1) {
+        QString fileName = QString::fromLocal8Bit(argv[1]);
+        QString error;
+        bool loaded = fileName.endsWith(".gvs", Qt::CaseInsensitive)
+            ? SceneFile::load(*scene, fileName, &error)
+            : SceneStream::importFile(*scene, fileName, &error);
+        if (!loaded)
+            qWarning("%s", qPrintable(error));
+    }
+    
     GridView view(std::move(scene));
     view.resize(800, 600);
     view.show();
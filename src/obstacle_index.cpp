@@ -0,0 +1,223 @@
+#include "obstacle_index.h"
+#include <algorithm>
+
+namespace {
+
+// Препятствия, покрывающие больше корзин, попадают в список больших
+const int kMaxBucketsPerObstacle = 1024;
+
+// Число корзин диапазона. Стороны и их произведение считаются в qint64:
+// в int они переполняются на препятствиях во всю координатную плоскость
+qint64 bucketCount(const QRect& range)
+{
+    return (static_cast<qint64>(range.right()) - range.left() + 1)
+         * (static_cast<qint64>(range.bottom()) - range.top() + 1);
+}
+
+void eraseId(std::vector<int>& ids, int id)
+{
+    auto it = std::find(ids.begin(), ids.end(), id);
+    if (it != ids.end()) {
+        *it = ids.back();
+        ids.pop_back();
+    }
+}
+
+// Удаляет прямоугольник с идентификатором id; порядок перестановки совпадает с eraseId
+void eraseRect(RectArray& rects, std::vector<int>& ids, int id)
+{
+    auto it = std::find(ids.begin(), ids.end(), id);
+    if (it != ids.end()) {
+        rects.removeAt(it - ids.begin());
+        *it = ids.back();
+        ids.pop_back();
+    }
+}
+
+}
+
+ObstacleIndex::ObstacleIndex(int bucketSize)
+    : m_bucketSize(bucketSize)
+{
+}
+
+void ObstacleIndex::insert(int id, const QRect& bounds)
+{
+    if (m_slots.count(id))
+        remove(id);
+
+    QRect normalized = bounds.normalized();
+    m_slots[id] = m_ids.size();
+    m_ids.push_back(id);
+    m_rects.append(normalized);
+
+    QRect range = bucketRange(normalized);
+    if (bucketCount(range) > kMaxBucketsPerObstacle) {
+        m_largeRects.append(normalized);
+        m_largeIds.push_back(id);
+        return;
+    }
+
+    for (int by = range.top(); by <= range.bottom(); ++by)
+        for (int bx = range.left(); bx <= range.right(); ++bx)
+            m_buckets[bucketKey(bx, by)].push_back(id);
+}
+
+void ObstacleIndex::remove(int id)
+{
+    auto it = m_slots.find(id);
+    if (it == m_slots.end())
+        return;
+
+    size_t slot = it->second;
+    QRect range = bucketRange(m_rects.at(slot));
+    m_slots.erase(it);
+
+    // Последний прямоугольник переезжает на место удаленного
+    m_rects.removeAt(slot);
+    if (slot != m_ids.size() - 1) {
+        m_ids[slot] = m_ids.back();
+        m_slots[m_ids[slot]] = slot;
+    }
+    m_ids.pop_back();
+
+    if (bucketCount(range) > kMaxBucketsPerObstacle) {
+        eraseRect(m_largeRects, m_largeIds, id);
+        return;
+    }
+
+    for (int by = range.top(); by <= range.bottom(); ++by) {
+        for (int bx = range.left(); bx <= range.right(); ++bx) {
+            auto bucket = m_buckets.find(bucketKey(bx, by));
+            if (bucket == m_buckets.end())
+                continue;
+            eraseId(bucket->second, id);
+            if (bucket->second.empty())
+                m_buckets.erase(bucket);
+        }
+    }
+}
+
+void ObstacleIndex::reserve(size_t count)
+{
+    // Пакетная вставка без перестроения хеш-таблиц на каждом элементе;
+    // запас растет не меньше чем вдвое, чтобы серия пакетов не перестраивала их каждый раз
+    size_t required = m_ids.size() + count;
+    if (required <= m_ids.capacity())
+        return;
+    required = std::max(required, 2 * m_ids.size());
+
+    m_rects.reserve(required);
+    m_ids.reserve(required);
+    m_slots.reserve(required);
+    m_buckets.reserve(m_buckets.size() + (required - m_ids.size()));
+}
+
+void ObstacleIndex::clear()
+{
+    m_rects.clear();
+    m_ids.clear();
+    m_slots.clear();
+    m_buckets.clear();
+    m_largeRects.clear();
+    m_largeIds.clear();
+}
+
+bool ObstacleIndex::contains(int id) const
+{
+    return m_slots.count(id) != 0;
+}
+
+QRect ObstacleIndex::bounds(int id) const
+{
+    auto it = m_slots.find(id);
+    return it != m_slots.end() ? m_rects.at(it->second) : QRect();
+}
+
+size_t ObstacleIndex::size() const
+{
+    return m_ids.size();
+}
+
+bool ObstacleIndex::containsPoint(const QPoint& pt) const
+{
+    // Вырожденные прямоугольники точек не содержат - как и в query, в обеих ветвях
+    auto contains = [&](const QRect& rect) {
+        return rect.isValid() && rect.contains(pt);
+    };
+
+    auto bucket = m_buckets.find(bucketKey(bucketOf(pt.x()), bucketOf(pt.y())));
+    if (bucket != m_buckets.end()) {
+        for (int id : bucket->second) {
+            if (contains(bounds(id)))
+                return true;
+        }
+    }
+
+    // Пакетная проверка отбирает кандидатов среди больших препятствий
+    const QRect box(pt, pt);
+    for (size_t i = m_largeRects.nextOverlapping(box); i < m_largeRects.size();
+         i = m_largeRects.nextOverlapping(box, i + 1)) {
+        if (contains(m_largeRects.at(i)))
+            return true;
+    }
+    return false;
+}
+
+std::vector<int> ObstacleIndex::query(const QRect& area) const
+{
+    std::vector<int> result;
+    QRect normalized = area.normalized();
+    QRect range = bucketRange(normalized);
+
+    auto accept = [&](int id) {
+        if (bounds(id).intersects(normalized))
+            result.push_back(id);
+    };
+
+    // Для большой области дешевле перебрать все препятствия; пакетная проверка
+    // отбирает кандидатов, accept отсеивает вырожденные прямоугольники, как QRect
+    if (bucketCount(range) > static_cast<qint64>(m_ids.size())) {
+        for (size_t i = m_rects.nextOverlapping(normalized); i < m_rects.size();
+             i = m_rects.nextOverlapping(normalized, i + 1))
+            accept(m_ids[i]);
+    } else {
+        for (int by = range.top(); by <= range.bottom(); ++by) {
+            for (int bx = range.left(); bx <= range.right(); ++bx) {
+                auto bucket = m_buckets.find(bucketKey(bx, by));
+                if (bucket == m_buckets.end())
+                    continue;
+                for (int id : bucket->second)
+                    accept(id);
+            }
+        }
+
+        for (size_t i = m_largeRects.nextOverlapping(normalized); i < m_largeRects.size();
+             i = m_largeRects.nextOverlapping(normalized, i + 1))
+            accept(m_largeIds[i]);
+    }
+
+    // Препятствие могло попасть в несколько корзин области
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+    return result;
+}
+
+QRect ObstacleIndex::bucketRange(const QRect& bounds) const
+{
+    return QRect(QPoint(bucketOf(bounds.left()), bucketOf(bounds.top())),
+                 QPoint(bucketOf(bounds.right()), bucketOf(bounds.bottom())));
+}
+
+int ObstacleIndex::bucketOf(int coord) const
+{
+    int q = coord / m_bucketSize;
+    if (coord % m_bucketSize != 0 && coord < 0)
+        --q;
+    return q;
+}
+
+quint64 ObstacleIndex::bucketKey(int bx, int by)
+{
+    return (quint64(quint32(bx)) << 32) | quint32(by);
+}
@@ -0,0 +1,205 @@
+#include "occupancy_grid.h"
+#include <algorithm>
+
+namespace {
+
+int floorDiv(int a, int b)
+{
+    int q = a / b;
+    if ((a % b != 0) && ((a < 0) != (b < 0)))
+        --q;
+    return q;
+}
+
+int ceilDiv(int a, int b)
+{
+    return -floorDiv(-a, b);
+}
+
+}
+
+OccupancyGrid::OccupancyGrid()
+    : m_step(0)
+{
+}
+
+bool OccupancyGrid::isValidFor(const std::vector<QRect>& obstacles, int step, const QRect& cellArea) const
+{
+    return m_step == step
+        && m_extent.contains(cellArea)
+        && m_obstacles == obstacles;
+}
+
+void OccupancyGrid::build(const std::vector<QRect>& obstacles, int step, const QRect& cellExtent)
+{
+    m_extent = cellExtent;
+    m_step = step;
+    m_obstacles = obstacles;
+
+    m_bits.assign((static_cast<size_t>(cellCount()) + 63) / 64, 0);
+    m_nearBits.assign(m_bits.size(), 0);
+
+    for (const QRect& rc : m_obstacles) {
+        QRect cells = blockedCells(rc, step);
+        if (!cells.isValid())
+            continue;
+
+        // Соседние узлы - кольцо вокруг препятствия: обходим только его периметр
+        QRect ring = cells.adjusted(-1, -1, 1, 1);
+        const int left = std::max(ring.left(), m_extent.left());
+        const int right = std::min(ring.right(), m_extent.right());
+        const int top = std::max(ring.top() + 1, m_extent.top());
+        const int bottom = std::min(ring.bottom() - 1, m_extent.bottom());
+        for (int gx = left; gx <= right; ++gx) {
+            markNear(gx, ring.top());
+            markNear(gx, ring.bottom());
+        }
+        for (int gy = top; gy <= bottom; ++gy) {
+            markNear(ring.left(), gy);
+            markNear(ring.right(), gy);
+        }
+
+        cells = cells.intersected(m_extent);
+        if (!cells.isValid())
+            continue;
+
+        for (int gy = cells.top(); gy <= cells.bottom(); ++gy)
+            for (int gx = cells.left(); gx <= cells.right(); ++gx)
+                setBlocked(indexOf(gx, gy));
+    }
+}
+
+bool OccupancyGrid::ensure(const std::vector<QRect>& obstacles, int step, const QRect& cellArea)
+{
+    if (isValidFor(obstacles, step, cellArea))
+        return false;
+
+    QRect extent = cellArea;
+    if (m_step == step && m_obstacles == obstacles)
+        extent |= m_extent;
+    build(obstacles, step, extent);
+    return true;
+}
+
+QRect OccupancyGrid::requiredExtent(const std::vector<QRect>& obstacles, int step,
+                                    const QPoint& startCell, const QPoint& goalCell, int margin)
+{
+    return requiredExtent(blockedExtent(obstacles, step), startCell, goalCell, margin);
+}
+
+QRect OccupancyGrid::requiredExtent(const QRect& blocked, const QPoint& startCell, const QPoint& goalCell, int margin)
+{
+    QRect extent(startCell, startCell);
+    extent |= QRect(goalCell, goalCell);
+    if (blocked.isValid())
+        extent |= blocked;
+
+    // Вне ограничивающего прямоугольника препятствий все свободно, поэтому
+    // кратчайший путь всегда укладывается в область с запасом в одну клетку
+    return extent.adjusted(-margin, -margin, margin, margin);
+}
+
+QRect OccupancyGrid::blockedExtent(const std::vector<QRect>& obstacles, int step)
+{
+    QRect extent;
+    for (const QRect& rc : obstacles) {
+        QRect cells = blockedCells(rc, step);
+        if (cells.isValid())
+            extent |= cells;
+    }
+    return extent;
+}
+
+QRect OccupancyGrid::blockedCells(const QRect& obstacle, int step)
+{
+    QRect r = obstacle.normalized();
+    return QRect(QPoint(ceilDiv(r.left(), step), ceilDiv(r.top(), step)),
+                 QPoint(floorDiv(r.right(), step), floorDiv(r.bottom(), step)));
+}
+
+const std::vector<QRect>& OccupancyGrid::obstacles() const
+{
+    return m_obstacles;
+}
+
+int OccupancyGrid::step() const
+{
+    return m_step;
+}
+
+int OccupancyGrid::width() const
+{
+    return m_extent.width();
+}
+
+int OccupancyGrid::height() const
+{
+    return m_extent.height();
+}
+
+int OccupancyGrid::cellCount() const
+{
+    return m_extent.isValid() ? width() * height() : 0;
+}
+
+QRect OccupancyGrid::cellExtent() const
+{
+    return m_extent;
+}
+
+bool OccupancyGrid::contains(int gx, int gy) const
+{
+    return gx >= m_extent.left() && gx <= m_extent.right()
+        && gy >= m_extent.top() && gy <= m_extent.bottom();
+}
+
+int OccupancyGrid::indexOf(int gx, int gy) const
+{
+    return (gy - m_extent.top()) * width() + (gx - m_extent.left());
+}
+
+QPoint OccupancyGrid::cellAt(int index) const
+{
+    return QPoint(m_extent.left() + index % width(), m_extent.top() + index / width());
+}
+
+bool OccupancyGrid::isBlocked(int gx, int gy) const
+{
+    if (!contains(gx, gy))
+        return true;
+    return isBlockedIndex(indexOf(gx, gy));
+}
+
+bool OccupancyGrid::isBlockedIndex(int index) const
+{
+    return (m_bits[static_cast<size_t>(index) >> 6] >> (index & 63)) & 1u;
+}
+
+bool OccupancyGrid::isNearObstacleIndex(int index) const
+{
+    // Кольцо одного препятствия может заходить внутрь другого
+    return ((m_nearBits[static_cast<size_t>(index) >> 6] >> (index & 63)) & 1u) && !isBlockedIndex(index);
+}
+
+int OccupancyGrid::toCell(int world, int step)
+{
+    return floorDiv(world, step);
+}
+
+QPoint OccupancyGrid::toCell(const QPoint& world, int step)
+{
+    return QPoint(floorDiv(world.x(), step), floorDiv(world.y(), step));
+}
+
+void OccupancyGrid::setBlocked(int index)
+{
+    m_bits[static_cast<size_t>(index) >> 6] |= quint64(1) << (index & 63);
+}
+
+void OccupancyGrid::markNear(int gx, int gy)
+{
+    if (!contains(gx, gy))
+        return;
+    int index = indexOf(gx, gy);
+    m_nearBits[static_cast<size_t>(index) >> 6] |= quint64(1) << (index & 63);
+}
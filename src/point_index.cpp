@@ -0,0 +1,92 @@
+#include "point_index.h"
+#include <algorithm>
+
+PointIndex::PointIndex(int bucketSize)
+    : m_bucketSize(bucketSize)
+{
+}
+
+void PointIndex::insert(int id, const QPoint& position)
+{
+    m_buckets[bucketKey(bucketOf(position.x()), bucketOf(position.y()))].push_back({ id, position });
+}
+
+void PointIndex::remove(int id, const QPoint& position)
+{
+    auto bucket = m_buckets.find(bucketKey(bucketOf(position.x()), bucketOf(position.y())));
+    if (bucket == m_buckets.end())
+        return;
+
+    std::vector<Entry>& entries = bucket->second;
+    auto it = std::find_if(entries.begin(), entries.end(),
+        [id](const Entry& entry) {
+            return entry.id == id;
+        });
+
+    if (it != entries.end()) {
+        *it = entries.back();
+        entries.pop_back();
+    }
+    if (entries.empty())
+        m_buckets.erase(bucket);
+}
+
+void PointIndex::move(int id, const QPoint& from, const QPoint& to)
+{
+    remove(id, from);
+    insert(id, to);
+}
+
+void PointIndex::reserve(size_t count)
+{
+    // Корзин не больше, чем точек: таблица не перестраивается при пакетной вставке.
+    // Запас растет не меньше чем вдвое, чтобы серия пакетов не перестраивала ее каждый раз
+    size_t required = m_buckets.size() + count;
+    if (required <= m_buckets.bucket_count() * m_buckets.max_load_factor())
+        return;
+    m_buckets.reserve(std::max(required, 2 * m_buckets.size()));
+}
+
+void PointIndex::clear()
+{
+    m_buckets.clear();
+}
+
+int PointIndex::pick(const QPoint& pos, int radius) const
+{
+    int bestId = -1;
+    qint64 bestDistance = qint64(radius) * radius;
+
+    for (int by = bucketOf(pos.y() - radius); by <= bucketOf(pos.y() + radius); ++by) {
+        for (int bx = bucketOf(pos.x() - radius); bx <= bucketOf(pos.x() + radius); ++bx) {
+            auto bucket = m_buckets.find(bucketKey(bx, by));
+            if (bucket == m_buckets.end())
+                continue;
+
+            for (const Entry& entry : bucket->second) {
+                qint64 dx = entry.position.x() - pos.x();
+                qint64 dy = entry.position.y() - pos.y();
+                qint64 distance = dx * dx + dy * dy;
+                if (distance <= bestDistance && (bestId == -1 || distance < bestDistance)) {
+                    bestDistance = distance;
+                    bestId = entry.id;
+                }
+            }
+        }
+    }
+
+    return bestId;
+}
+
+int PointIndex::bucketOf(int coord) const
+{
+    int q = coord / m_bucketSize;
+    if (coord % m_bucketSize != 0 && coord < 0)
+        --q;
+    return q;
+}
+
+quint64 PointIndex::bucketKey(int bx, int by)
+{
+    return (quint64(quint32(bx)) << 32) | quint32(by);
+}
@@ -0,0 +1,190 @@
+#include "rect_array.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define RECT_ARRAY_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define RECT_ARRAY_SSE2
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace {
+
+#if defined(RECT_ARRAY_AVX2) || defined(RECT_ARRAY_SSE2)
+int lowestBit(unsigned mask)
+{
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return static_cast<int>(index);
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+#endif
+
+struct Box {
+    qint32 x1;
+    qint32 y1;
+    qint32 x2;
+    qint32 y2;
+};
+
+size_t nextOverlappingIn(const qint32* x1s, const qint32* y1s, const qint32* x2s, const qint32* y2s,
+                         size_t count, const Box& box, size_t from)
+{
+    size_t i = from;
+
+    // Прямоугольник не пересекает рамку, только если лежит целиком по одну сторону от нее
+#if defined(RECT_ARRAY_AVX2)
+    const __m256i bx1 = _mm256_set1_epi32(box.x1);
+    const __m256i by1 = _mm256_set1_epi32(box.y1);
+    const __m256i bx2 = _mm256_set1_epi32(box.x2);
+    const __m256i by2 = _mm256_set1_epi32(box.y2);
+
+    for (; i + 8 <= count; i += 8)
+    {
+        __m256i x1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(x1s + i));
+        __m256i y1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(y1s + i));
+        __m256i x2 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(x2s + i));
+        __m256i y2 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(y2s + i));
+
+        __m256i outside = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpgt_epi32(bx1, x2), _mm256_cmpgt_epi32(x1, bx2)),
+            _mm256_or_si256(_mm256_cmpgt_epi32(by1, y2), _mm256_cmpgt_epi32(y1, by2)));
+
+        unsigned mask = ~static_cast<unsigned>(_mm256_movemask_ps(_mm256_castsi256_ps(outside))) & 0xffu;
+        if (mask)
+            return i + lowestBit(mask);
+    }
+#elif defined(RECT_ARRAY_SSE2)
+    const __m128i bx1 = _mm_set1_epi32(box.x1);
+    const __m128i by1 = _mm_set1_epi32(box.y1);
+    const __m128i bx2 = _mm_set1_epi32(box.x2);
+    const __m128i by2 = _mm_set1_epi32(box.y2);
+
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128i x1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(x1s + i));
+        __m128i y1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(y1s + i));
+        __m128i x2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(x2s + i));
+        __m128i y2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(y2s + i));
+
+        __m128i outside = _mm_or_si128(
+            _mm_or_si128(_mm_cmpgt_epi32(bx1, x2), _mm_cmpgt_epi32(x1, bx2)),
+            _mm_or_si128(_mm_cmpgt_epi32(by1, y2), _mm_cmpgt_epi32(y1, by2)));
+
+        unsigned mask = ~static_cast<unsigned>(_mm_movemask_ps(_mm_castsi128_ps(outside))) & 0xfu;
+        if (mask)
+            return i + lowestBit(mask);
+    }
+#endif
+
+    // Хвост, не кратный ширине блока, и вариант без SIMD
+    for (; i < count; ++i)
+    {
+        if (box.x1 <= x2s[i] && x1s[i] <= box.x2 && box.y1 <= y2s[i] && y1s[i] <= box.y2)
+            return i;
+    }
+    return count;
+}
+
+}
+
+void RectArray::clear()
+{
+    m_x1.clear();
+    m_y1.clear();
+    m_x2.clear();
+    m_y2.clear();
+}
+
+void RectArray::reserve(size_t count)
+{
+    m_x1.reserve(count);
+    m_y1.reserve(count);
+    m_x2.reserve(count);
+    m_y2.reserve(count);
+}
+
+void RectArray::append(const QRect& rect)
+{
+    QRect r = rect.normalized();
+    m_x1.push_back(r.left());
+    m_y1.push_back(r.top());
+    m_x2.push_back(r.right());
+    m_y2.push_back(r.bottom());
+}
+
+void RectArray::set(size_t index, const QRect& rect)
+{
+    QRect r = rect.normalized();
+    m_x1[index] = r.left();
+    m_y1[index] = r.top();
+    m_x2[index] = r.right();
+    m_y2[index] = r.bottom();
+}
+
+void RectArray::removeAt(size_t index)
+{
+    size_t last = size() - 1;
+    if (index != last) {
+        m_x1[index] = m_x1[last];
+        m_y1[index] = m_y1[last];
+        m_x2[index] = m_x2[last];
+        m_y2[index] = m_y2[last];
+    }
+    m_x1.pop_back();
+    m_y1.pop_back();
+    m_x2.pop_back();
+    m_y2.pop_back();
+}
+
+size_t RectArray::size() const
+{
+    return m_x1.size();
+}
+
+bool RectArray::empty() const
+{
+    return m_x1.empty();
+}
+
+QRect RectArray::at(size_t index) const
+{
+    return QRect(QPoint(m_x1[index], m_y1[index]), QPoint(m_x2[index], m_y2[index]));
+}
+
+size_t RectArray::nextOverlapping(const QRect& box, size_t from) const
+{
+    QRect r = box.normalized();
+    return nextOverlappingIn(m_x1.data(), m_y1.data(), m_x2.data(), m_y2.data(), size(),
+                             { r.left(), r.top(), r.right(), r.bottom() }, from);
+}
+
+int RectArray::findContaining(const QPoint& pt) const
+{
+    size_t index = nextOverlappingIn(m_x1.data(), m_y1.data(), m_x2.data(), m_y2.data(), size(),
+                                     { pt.x(), pt.y(), pt.x(), pt.y() }, 0);
+    return index < size() ? static_cast<int>(index) : -1;
+}
+
+bool RectArray::containsPoint(const QPoint& pt) const
+{
+    return findContaining(pt) != -1;
+}
+
+const char* RectArray::instructionSet()
+{
+#if defined(RECT_ARRAY_AVX2)
+    return "avx2";
+#elif defined(RECT_ARRAY_SSE2)
+    return "sse2";
+#else
+    return "scalar";
+#endif
+}
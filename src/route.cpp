@@ -1,9 +1,62 @@
 #include "route.h"
+#include <cstdlib>
+
+namespace {
+
+int sign(int value)
+{
+    return (value > 0) - (value < 0);
+}
+
+// Направление шага между соседними точками пути
+QPoint direction(const QPoint& from, const QPoint& to)
+{
+    return QPoint(sign(to.x() - from.x()), sign(to.y() - from.y()));
+}
+
+}
+
+Route::CellIterator::CellIterator(const Route* route, size_t index)
+    : m_route(route)
+    , m_index(index)
+    , m_nextCorner(1)
+{
+    if (index == 0 && route->m_length > 0)
+        m_current = route->m_corners.front();
+}
+
+Route::CellIterator& Route::CellIterator::operator++()
+{
+    // За последним узлом сдвигается только номер: итератор становится end()
+    if (++m_index >= m_route->m_length)
+        return *this;
+
+    const QPoint& target = m_route->m_corners[m_nextCorner];
+    if (m_route->m_step == 0) {
+        m_current = target;
+        ++m_nextCorner;
+        return *this;
+    }
+
+    m_current += direction(m_current, target) * m_route->m_step;
+    if (m_current == target)
+        ++m_nextCorner;
+    return *this;
+}
+
+Route::CellIterator Route::CellIterator::operator++(int)
+{
+    CellIterator previous = *this;
+    ++*this;
+    return previous;
+}
 
 Route::Route(int id, int startId, int endId)
     : m_id(id)
     , m_startId(startId)
     , m_endId(endId)
+    , m_length(0)
+    , m_step(0)
 {
 }
 
@@ -22,12 +75,74 @@ int Route::getEndId() const
     return m_endId;
 }
 
-const std::vector<QPoint>& Route::getPath() const
+Route::Cells Route::cells() const
+{
+    return Cells(this);
+}
+
+std::vector<QPoint> Route::getPath() const
 {
-    return m_path;
+    Cells path = cells();
+    return std::vector<QPoint>(path.begin(), path.end());
 }
 
 void Route::setPath(const std::vector<QPoint>& path)
 {
-    m_path = path;
-}
\ No newline at end of file
+    m_length = path.size();
+    m_step = gridStep(path);
+    
+    if (m_step == 0) {
+        m_corners = path;
+        return;
+    }
+    
+    m_corners.clear();
+    for (const QPoint& pt : path) {
+        // Точка продолжает отрезок в том же направлении - сдвигаем его конец
+        size_t n = m_corners.size();
+        if (n >= 2 && direction(m_corners[n - 2], m_corners[n - 1]) == direction(m_corners[n - 1], pt)) {
+            m_corners.back() = pt;
+            continue;
+        }
+        
+        m_corners.push_back(pt);
+    }
+    m_corners.shrink_to_fit();
+}
+
+void Route::setPath(std::vector<QPoint>&& path)
+{
+    // Путь не по сетке не сжимается - забираем буфер целиком
+    if (gridStep(path) == 0) {
+        m_length = path.size();
+        m_step = 0;
+        m_corners = std::move(path);
+        return;
+    }
+    
+    setPath(static_cast<const std::vector<QPoint>&>(path));
+}
+
+const std::vector<QPoint>& Route::getCorners() const
+{
+    return m_corners;
+}
+
+int Route::gridStep(const std::vector<QPoint>& path)
+{
+    // Все шаги - по одной оси и одной длины, иначе точки поворота не
+    // восстанавливают путь однозначно
+    int step = 0;
+    for (size_t i = 1; i < path.size(); ++i) {
+        int dx = path[i].x() - path[i - 1].x();
+        int dy = path[i].y() - path[i - 1].y();
+        if ((dx != 0) == (dy != 0))
+            return 0;
+        
+        int length = std::abs(dx) + std::abs(dy);
+        if (step != 0 && length != step)
+            return 0;
+        step = length;
+    }
+    return step;
+}
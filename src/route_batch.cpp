@@ -0,0 +1,23 @@
+#include "route_batch.h"
+#include <map>
+
+namespace RouteBatch {
+
+std::vector<std::vector<int>> groupBySource(const std::vector<RouteEndpoints>& endpoints)
+{
+    std::vector<std::vector<int>> groups;
+    std::map<std::pair<int, int>, size_t> groupOf;
+
+    for (size_t i = 0; i < endpoints.size(); ++i)
+    {
+        const QPoint& start = endpoints[i].first;
+        auto it = groupOf.emplace(std::make_pair(start.x(), start.y()), groups.size()).first;
+        if (it->second == groups.size())
+            groups.emplace_back();
+        groups[it->second].push_back(static_cast<int>(i));
+    }
+
+    return groups;
+}
+
+}
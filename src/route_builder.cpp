@@ -1,10 +1,11 @@
 #include "route_builder.h"
-#include <limits>
 #include <algorithm>
-#include <QQueue>
-#include <QHash>
+#include <limits>
+#include <cstdlib>
 
-RouteBuilder::RouteBuilder()
+RouteBuilder::RouteBuilder(SearchMode mode, const GridSettings& settings)
+    : m_mode(mode)
+    , m_settings(settings)
 {
 }
 
@@ -16,31 +17,50 @@ std::vector<QPoint> RouteBuilder::buildRoute(
     return buildRouteInternal(start, end, obstacles);
 }
 
-bool RouteBuilder::lineIntersectsRect(const QLineF& line, const QRect& rect) const
+std::vector<std::vector<QPoint>> RouteBuilder::buildRoutes(
+    const std::vector<RouteEndpoints>& endpoints,
+    const std::vector<QRect>& obstacles)
 {
-    QLineF edges[4] = {
-        QLineF(rect.topLeft(), rect.topRight()),
-        QLineF(rect.topRight(), rect.bottomRight()),
-        QLineF(rect.bottomRight(), rect.bottomLeft()),
-        QLineF(rect.bottomLeft(), rect.topLeft())
+    std::vector<std::vector<QPoint>> paths(endpoints.size());
+    SearchStats total;
+    total.reached = true;
+
+    auto accumulate = [&]() {
+        total.nodesExpanded += m_stats.nodesExpanded;
+        total.openListPeak = std::max(total.openListPeak, m_stats.openListPeak);
+        total.reached = total.reached && m_stats.reached;
     };
 
-    for (int i = 0; i < 4; ++i)
+    for (const std::vector<int>& group : RouteBatch::groupBySource(endpoints))
     {
-        QPointF intersectPoint;
-        if (line.intersects(edges[i], &intersectPoint) == QLineF::BoundedIntersection)
-            return true;
+        // Дерево поиска в ширину дает кратчайшие пути только при равноценных
+        // шагах; одиночный маршрут быстрее найти направленным поиском. Из равных
+        // по длине путей дерево выбирает тот же, что и A* (см. extractPath),
+        // а двунаправленные режимы - другой, поэтому их группы ищутся по одному
+        if (group.size() > 1 && m_settings.isUniform() && m_mode == SearchMode::AStar) {
+            buildRouteTree(endpoints, group, obstacles, paths);
+            accumulate();
+            continue;
+        }
+
+        for (int i : group) {
+            paths[i] = buildRouteInternal(endpoints[i].first, endpoints[i].second, obstacles);
+            accumulate();
+        }
     }
-    return false;
+
+    m_stats = total;
+    return paths;
 }
 
-bool RouteBuilder::segmentIntersectsBlocked(const QLineF& seg, const std::vector<QRect>& obstacles) const
+std::unique_ptr<IRouteBuilder> RouteBuilder::clone() const
 {
-    for (const QRect& rc : obstacles) {
-        if (lineIntersectsRect(seg, rc))
-            return true;
-    }
-    return false;
+    return std::make_unique<RouteBuilder>(m_mode, m_settings);
+}
+
+SearchStats RouteBuilder::lastSearchStats() const
+{
+    return m_stats;
 }
 
 std::vector<QPoint> RouteBuilder::buildRouteInternal(
@@ -49,30 +69,77 @@ std::vector<QPoint> RouteBuilder::buildRouteInternal(
     const std::vector<QRect>& obstacles,
     int maxOffsetMultiplier)
 {
-    const int step = 25;
-
-    QPoint start(
-        a.x() / step,
-        a.y() / step
-    );
-    QPoint goal(
-        b.x() / step,
-        b.y() / step
-    );
-
-    auto isBlocked = [&](int gx, int gy) {
-        QPoint real(gx * step, gy * step);
-        for (const QRect& rc : obstacles)
-            if (rc.contains(real))
-                return true;
-        return false;
+    const int step = m_settings.cellSize;
+
+    QPoint start = OccupancyGrid::toCell(a, step);
+    QPoint goal = OccupancyGrid::toCell(b, step);
+    m_stats = SearchStats();
+
+    // Поиск ограничен областью, зависящей только от входных данных запроса,
+    // поэтому результат не зависит от истории запросов построителя
+    QRect bounds = OccupancyGrid::requiredExtent(obstacles, step, start, goal, maxOffsetMultiplier);
+
+    // Карта занятости строится один раз на набор препятствий и только расширяется
+    m_grid.ensure(obstacles, step, bounds);
+
+    // Если цель недостижима
+    if (m_grid.isBlocked(goal.x(), goal.y()))
+        return { a, b };
+
+    const int startIndex = m_grid.indexOf(start.x(), start.y());
+    const int goalIndex = m_grid.indexOf(goal.x(), goal.y());
+
+    // Двунаправленному поиску нужны два разных конца
+    if (startIndex == goalIndex) {
+        m_stats.reached = true;
+        return { QPoint(start.x() * step, start.y() * step) };
+    }
+
+    std::vector<QPoint> path;
+    if (!m_settings.isUniform()) {
+        path = searchWeighted(startIndex, goalIndex, bounds, step);
+    } else {
+        switch (m_mode) {
+        case SearchMode::BidirectionalBfs:
+            path = searchBidirectionalBfs(startIndex, goalIndex, bounds, step);
+            break;
+        case SearchMode::BidirectionalAStar:
+            path = searchBidirectionalAStar(startIndex, goalIndex, bounds, step);
+            break;
+        case SearchMode::AStar:
+            path = searchAStar(startIndex, goalIndex, bounds, step);
+            break;
+        }
+    }
+
+    // Если цель недостижима
+    if (path.empty())
+        return { a, b };
+
+    m_stats.reached = true;
+    return path;
+}
+
+std::vector<QPoint> RouteBuilder::searchAStar(int startIndex, int goalIndex, const QRect& bounds, int step)
+{
+    const QPoint goal = m_grid.cellAt(goalIndex);
+
+    m_workspace.reset(m_grid.cellCount());
+    std::vector<OpenNode>& open = m_workspace.open();
+
+    auto heuristic = [&](const QPoint& c) {
+        return std::abs(c.x() - goal.x()) + std::abs(c.y() - goal.y());
     };
 
-    QQueue<QPoint> q;
-    QHash<QPoint, QPoint> parent;
+    // Меньшее f выше; при равных f предпочитаем более глубокие узлы
+    auto worse = [](const OpenNode& lhs, const OpenNode& rhs) {
+        if (lhs.f != rhs.f)
+            return lhs.f > rhs.f;
+        return lhs.g < rhs.g;
+    };
 
-    q.enqueue(start);
-    parent[start] = start;
+    m_workspace.visit(startIndex, 0, startIndex);
+    open.push_back({ heuristic(m_grid.cellAt(startIndex)), 0, startIndex });
 
     const QPoint dirs[4] = {
         QPoint(1, 0),
@@ -81,38 +148,577 @@ std::vector<QPoint> RouteBuilder::buildRouteInternal(
         QPoint(0, -1)
     };
 
-    while (!q.isEmpty())
+    while (!open.empty())
     {
-        QPoint cur = q.dequeue();
+        std::pop_heap(open.begin(), open.end(), worse);
+        OpenNode cur = open.back();
+        open.pop_back();
 
-        if (cur == goal)
+        if (cur.g > m_workspace.cost(cur.index)) continue;
+        if (cur.index == goalIndex)
             break;
 
+        ++m_stats.nodesExpanded;
+
+        QPoint cell = m_grid.cellAt(cur.index);
+
         for (auto d : dirs)
         {
-            QPoint nxt(cur.x() + d.x(), cur.y() + d.y());
+            QPoint nxt(cell.x() + d.x(), cell.y() + d.y());
 
-            if (parent.contains(nxt)) continue;
-            if (isBlocked(nxt.x(), nxt.y())) continue;
+            if (!bounds.contains(nxt)) continue;
 
-            parent[nxt] = cur;
-            q.enqueue(nxt);
+            int index = m_grid.indexOf(nxt.x(), nxt.y());
+            if (m_grid.isBlockedIndex(index)) continue;
+
+            int g = cur.g + 1;
+            if (g >= m_workspace.cost(index)) continue;
+
+            m_workspace.visit(index, g, cur.index);
+            open.push_back({ g + heuristic(nxt), g, index });
+            std::push_heap(open.begin(), open.end(), worse);
         }
+
+        m_stats.openListPeak = std::max(m_stats.openListPeak, static_cast<int>(open.size()));
     }
 
-    // Если цель недостижима
-    if (!parent.contains(goal))
-        return { a, b };
+    if (!m_workspace.isVisited(goalIndex))
+        return {};
+    return extractPath(startIndex, goalIndex, bounds, step, false);
+}
+
+std::vector<QPoint> RouteBuilder::searchBidirectionalBfs(int startIndex, int goalIndex, const QRect& bounds, int step)
+{
+    m_workspace.reset(m_grid.cellCount());
+    m_backward.reset(m_grid.cellCount());
+
+    std::vector<int>& forwardQueue = m_workspace.queue();
+    std::vector<int>& backwardQueue = m_backward.queue();
+    size_t forwardHead = 0;
+    size_t backwardHead = 0;
+
+    m_workspace.visit(startIndex, 0, startIndex);
+    forwardQueue.push_back(startIndex);
+    m_backward.visit(goalIndex, 0, goalIndex);
+    backwardQueue.push_back(goalIndex);
+
+    const QPoint dirs[4] = {
+        QPoint(1, 0),
+        QPoint(-1, 0),
+        QPoint(0, 1),
+        QPoint(0, -1)
+    };
+
+    int best = std::numeric_limits<int>::max();
+    int forwardMeet = -1;
+    int backwardMeet = -1;
+
+    // Слои раскрываются целиком, каждый раз у меньшего фронта. Все пути короче
+    // суммы глубин уже найдены, поэтому кратчайшая встреча известна к концу
+    // слоя, на котором встретились фронты
+    while (best == std::numeric_limits<int>::max()
+           && forwardHead < forwardQueue.size() && backwardHead < backwardQueue.size())
+    {
+        const bool forward = forwardQueue.size() - forwardHead <= backwardQueue.size() - backwardHead;
+        SearchWorkspace& self = forward ? m_workspace : m_backward;
+        const SearchWorkspace& other = forward ? m_backward : m_workspace;
+        std::vector<int>& queue = forward ? forwardQueue : backwardQueue;
+        size_t& head = forward ? forwardHead : backwardHead;
+
+        for (const size_t layerEnd = queue.size(); head < layerEnd; ++head)
+        {
+            int current = queue[head];
+            QPoint cell = m_grid.cellAt(current);
+            ++m_stats.nodesExpanded;
+
+            for (auto d : dirs)
+            {
+                QPoint nxt(cell.x() + d.x(), cell.y() + d.y());
+                if (!bounds.contains(nxt)) continue;
+
+                // Старт может лежать внутри препятствия: обратный поиск в него входит
+                int index = m_grid.indexOf(nxt.x(), nxt.y());
+                if (m_grid.isBlockedIndex(index) && index != startIndex) continue;
+
+                if (other.isVisited(index)) {
+                    int length = self.cost(current) + 1 + other.cost(index);
+                    if (length < best) {
+                        best = length;
+                        forwardMeet = forward ? current : index;
+                        backwardMeet = forward ? index : current;
+                    }
+                }
+
+                if (self.isVisited(index)) continue;
+                self.visit(index, self.cost(current) + 1, current);
+                queue.push_back(index);
+            }
+        }
+
+        int frontier = static_cast<int>(forwardQueue.size() - forwardHead + backwardQueue.size() - backwardHead);
+        m_stats.openListPeak = std::max(m_stats.openListPeak, frontier);
+    }
+
+    if (forwardMeet == -1)
+        return {};
+    return extractPath(startIndex, goalIndex, forwardMeet, backwardMeet, step);
+}
+
+std::vector<QPoint> RouteBuilder::searchBidirectionalAStar(int startIndex, int goalIndex, const QRect& bounds, int step)
+{
+    const QPoint start = m_grid.cellAt(startIndex);
+    const QPoint goal = m_grid.cellAt(goalIndex);
+
+    m_workspace.reset(m_grid.cellCount());
+    m_backward.reset(m_grid.cellCount());
+    std::vector<OpenNode>& forwardOpen = m_workspace.open();
+    std::vector<OpenNode>& backwardOpen = m_backward.open();
+
+    auto manhattan = [](const QPoint& lhs, const QPoint& rhs) {
+        return std::abs(lhs.x() - rhs.x()) + std::abs(lhs.y() - rhs.y());
+    };
+
+    // Меньшее f выше; при равных f предпочитаем более глубокие узлы
+    auto worse = [](const OpenNode& lhs, const OpenNode& rhs) {
+        if (lhs.f != rhs.f)
+            return lhs.f > rhs.f;
+        return lhs.g < rhs.g;
+    };
+
+    // Снимает с вершины кучи узлы, для которых уже найден путь короче
+    auto dropStale = [&worse](std::vector<OpenNode>& open, const SearchWorkspace& workspace) {
+        while (!open.empty() && open.front().g > workspace.cost(open.front().index)) {
+            std::pop_heap(open.begin(), open.end(), worse);
+            open.pop_back();
+        }
+    };
+
+    m_workspace.visit(startIndex, 0, startIndex);
+    forwardOpen.push_back({ manhattan(start, goal), 0, startIndex });
+    m_backward.visit(goalIndex, 0, goalIndex);
+    backwardOpen.push_back({ manhattan(goal, start), 0, goalIndex });
+
+    const QPoint dirs[4] = {
+        QPoint(1, 0),
+        QPoint(-1, 0),
+        QPoint(0, 1),
+        QPoint(0, -1)
+    };
+
+    int best = std::numeric_limits<int>::max();
+    int forwardMeet = -1;
+    int backwardMeet = -1;
+
+    while (true)
+    {
+        dropStale(forwardOpen, m_workspace);
+        dropStale(backwardOpen, m_backward);
+        if (forwardOpen.empty() || backwardOpen.empty())
+            break;
+
+        // Эвристика согласована, поэтому любой еще не найденный путь проходит
+        // через открытый узел каждой стороны и не короче его f: как только
+        // меньшее f одной из сторон достигло лучшей встречи, она кратчайшая
+        if (forwardOpen.front().f >= best || backwardOpen.front().f >= best)
+            break;
+
+        const bool forward = forwardOpen.size() <= backwardOpen.size();
+        SearchWorkspace& self = forward ? m_workspace : m_backward;
+        const SearchWorkspace& other = forward ? m_backward : m_workspace;
+        std::vector<OpenNode>& open = forward ? forwardOpen : backwardOpen;
+        const QPoint& target = forward ? goal : start;
+
+        std::pop_heap(open.begin(), open.end(), worse);
+        OpenNode cur = open.back();
+        open.pop_back();
+
+        ++m_stats.nodesExpanded;
+
+        QPoint cell = m_grid.cellAt(cur.index);
+
+        for (auto d : dirs)
+        {
+            QPoint nxt(cell.x() + d.x(), cell.y() + d.y());
+            if (!bounds.contains(nxt)) continue;
+
+            // Старт может лежать внутри препятствия: обратный поиск в него входит
+            int index = m_grid.indexOf(nxt.x(), nxt.y());
+            if (m_grid.isBlockedIndex(index) && index != startIndex) continue;
+
+            int g = cur.g + 1;
+            if (other.isVisited(index) && g + other.cost(index) < best) {
+                best = g + other.cost(index);
+                forwardMeet = forward ? cur.index : index;
+                backwardMeet = forward ? index : cur.index;
+            }
+
+            if (g >= self.cost(index)) continue;
+
+            self.visit(index, g, cur.index);
+            open.push_back({ g + manhattan(nxt, target), g, index });
+            std::push_heap(open.begin(), open.end(), worse);
+        }
+
+        int openSize = static_cast<int>(forwardOpen.size() + backwardOpen.size());
+        m_stats.openListPeak = std::max(m_stats.openListPeak, openSize);
+    }
+
+    if (forwardMeet == -1)
+        return {};
+    return extractPath(startIndex, goalIndex, forwardMeet, backwardMeet, step);
+}
+
+std::vector<QPoint> RouteBuilder::searchWeighted(int startIndex, int goalIndex, const QRect& bounds, int step)
+{
+    const QPoint goal = m_grid.cellAt(goalIndex);
+    const int stepCost = m_settings.stepCost;
+    const int directionCount = 4;
+
+    // Узел поиска - пара (узел сетки, направление входа в него): цена следующего
+    // шага зависит от того, поворачивает ли на нем путь
+    m_workspace.reset(m_grid.cellCount() * directionCount);
+    BucketQueue& open = m_workspace.buckets();
+
+    // Шаг стоит не меньше stepCost и меняет эвристику не больше чем на stepCost,
+    // поэтому f соседа больше f узла не более чем на цену шага плюс stepCost
+    open.reset(2 * stepCost + m_settings.nearObstacleCost + m_settings.turnCost);
+
+    auto heuristic = [&](const QPoint& c) {
+        return (std::abs(c.x() - goal.x()) + std::abs(c.y() - goal.y())) * stepCost;
+    };
+
+    // Противоположные направления отличаются младшим битом
+    const QPoint dirs[directionCount] = {
+        QPoint(1, 0),
+        QPoint(-1, 0),
+        QPoint(0, 1),
+        QPoint(0, -1)
+    };
+
+    // Из старта можно выйти в любом направлении без поворота
+    const int startH = heuristic(m_grid.cellAt(startIndex));
+    for (int d = 0; d < directionCount; ++d) {
+        int state = startIndex * directionCount + d;
+        m_workspace.visit(state, 0, state);
+        open.push(startH, state);
+    }
+
+    int goalState = -1;
+    while (!open.empty())
+    {
+        int f;
+        const int state = open.pop(f);
+        const int index = state / directionCount;
+        const int dir = state % directionCount;
+        const QPoint cell = m_grid.cellAt(index);
+        const int g = m_workspace.cost(state);
+
+        // Узел уже извлекался с меньшей стоимостью
+        if (g + heuristic(cell) != f) continue;
+        if (index == goalIndex) {
+            goalState = state;
+            break;
+        }
+
+        ++m_stats.nodesExpanded;
+
+        for (int d = 0; d < directionCount; ++d)
+        {
+            // Разворот на месте никогда не выгоден
+            if (d == (dir ^ 1)) continue;
+
+            QPoint nxt(cell.x() + dirs[d].x(), cell.y() + dirs[d].y());
+            if (!bounds.contains(nxt)) continue;
+
+            int next = m_grid.indexOf(nxt.x(), nxt.y());
+            if (m_grid.isBlockedIndex(next)) continue;
+
+            int cost = g + stepCost;
+            if (m_grid.isNearObstacleIndex(next))
+                cost += m_settings.nearObstacleCost;
+            if (d != dir)
+                cost += m_settings.turnCost;
+
+            int nextState = next * directionCount + d;
+            if (cost >= m_workspace.cost(nextState)) continue;
+
+            m_workspace.visit(nextState, cost, state);
+            open.push(cost + heuristic(nxt), nextState);
+        }
+
+        m_stats.openListPeak = std::max(m_stats.openListPeak, open.size());
+    }
+
+    if (goalState == -1)
+        return {};
+    return extractWeightedPath(goalState, step);
+}
+
+void RouteBuilder::buildRouteTree(
+    const std::vector<RouteEndpoints>& endpoints,
+    const std::vector<int>& group,
+    const std::vector<QRect>& obstacles,
+    std::vector<std::vector<QPoint>>& paths,
+    int maxOffsetMultiplier)
+{
+    const int step = m_settings.cellSize;
+
+    QPoint start = OccupancyGrid::toCell(endpoints[group.front()].first, step);
+    m_stats = SearchStats();
+
+    // Область поиска - объединение областей одиночных запросов группы
+    QRect bounds;
+    for (int i : group) {
+        QPoint goal = OccupancyGrid::toCell(endpoints[i].second, step);
+        bounds |= OccupancyGrid::requiredExtent(obstacles, step, start, goal, maxOffsetMultiplier);
+    }
+
+    // Карта занятости строится один раз на набор препятствий и только расширяется
+    m_grid.ensure(obstacles, step, bounds);
+
+    const int cellCount = m_grid.cellCount();
+    const int startIndex = m_grid.indexOf(start.x(), start.y());
+
+    m_workspace.reset(cellCount);
+    std::vector<int>& queue = m_workspace.queue();
+
+    // Заблокированные цели недостижимы и не учитываются
+    int remaining = 0;
+    for (int i : group) {
+        QPoint goal = OccupancyGrid::toCell(endpoints[i].second, step);
+        int goalIndex = m_grid.indexOf(goal.x(), goal.y());
+        if (m_grid.isBlockedIndex(goalIndex) || m_workspace.isMarked(goalIndex))
+            continue;
+        m_workspace.mark(goalIndex);
+        ++remaining;
+    }
+
+    m_workspace.visit(startIndex, 0, startIndex);
+    queue.push_back(startIndex);
+    if (m_workspace.isMarked(startIndex))
+        --remaining;
+
+    const QPoint dirs[4] = {
+        QPoint(1, 0),
+        QPoint(-1, 0),
+        QPoint(0, 1),
+        QPoint(0, -1)
+    };
+
+    // Все шаги одной стоимости: узел получает кратчайшее расстояние при первом
+    // попадании в очередь, поэтому поиск останавливается на последней цели
+    for (size_t head = 0; head < queue.size() && remaining > 0; ++head)
+    {
+        int current = queue[head];
+        QPoint cell = m_grid.cellAt(current);
+        ++m_stats.nodesExpanded;
+
+        for (auto d : dirs)
+        {
+            QPoint nxt(cell.x() + d.x(), cell.y() + d.y());
+
+            if (!bounds.contains(nxt)) continue;
+
+            int index = m_grid.indexOf(nxt.x(), nxt.y());
+            if (m_grid.isBlockedIndex(index) || m_workspace.isVisited(index)) continue;
+
+            m_workspace.visit(index, m_workspace.cost(current) + 1, current);
+            queue.push_back(index);
+
+            if (m_workspace.isMarked(index))
+                --remaining;
+        }
+    }
+
+    m_stats.openListPeak = static_cast<int>(queue.size());
+    m_stats.reached = true;
+
+    for (int i : group)
+    {
+        const RouteEndpoints& ends = endpoints[i];
+        QPoint goal = OccupancyGrid::toCell(ends.second, step);
+        int goalIndex = m_grid.indexOf(goal.x(), goal.y());
+
+        // Если цель недостижима
+        if (m_grid.isBlockedIndex(goalIndex) || !m_workspace.isVisited(goalIndex)) {
+            paths[i] = { ends.first, ends.second };
+            m_stats.reached = false;
+            continue;
+        }
+
+        paths[i] = extractPath(startIndex, goalIndex, bounds, step, true);
+    }
+}
+
+std::vector<QPoint> RouteBuilder::extractPath(int startIndex, int goalIndex, const QRect& bounds, int step, bool exactCosts)
+{
+    const int length = m_workspace.cost(goalIndex);
+    const QPoint start = m_grid.cellAt(startIndex);
+    const QPoint goal = m_grid.cellAt(goalIndex);
+
+    const QPoint dirs[4] = {
+        QPoint(1, 0),
+        QPoint(-1, 0),
+        QPoint(0, 1),
+        QPoint(0, -1)
+    };
 
+    // Единственное выделение памяти запроса - сам результат
     std::vector<QPoint> pathGrid;
-    QPoint p = goal;
+    pathGrid.reserve(length + 1);
+    int p = goalIndex;
+
+    // Путь идет от цели к старту через первого по порядку направлений соседа,
+    // который на 1 ближе к старту. Выбор зависит только от расстояний, а не от
+    // порядка обхода, поэтому дерево пакета и A* одиночного запроса из равных
+    // по длине путей выбирают один и тот же
+    for (int distance = length; distance > 0; --distance) {
+        QPoint c = m_grid.cellAt(p);
+        pathGrid.push_back(QPoint(c.x() * step, c.y() * step));
+
+        for (auto d : dirs) {
+            QPoint prev(c.x() + d.x(), c.y() + d.y());
+            if (!bounds.contains(prev)) continue;
 
-    while (p != start) {
-        pathGrid.push_back(QPoint(p.x() * step, p.y() * step));
-        p = parent[p];
+            int index = m_grid.indexOf(prev.x(), prev.y());
+            bool closer = exactCosts
+                ? m_workspace.cost(index) == distance - 1
+                : hasStartDistance(index, distance - 1, length, start, goal, bounds);
+            if (closer) {
+                p = index;
+                break;
+            }
+        }
     }
     pathGrid.push_back(QPoint(start.x() * step, start.y() * step));
 
     std::reverse(pathGrid.begin(), pathGrid.end());
     return pathGrid;
-}
\ No newline at end of file
+}
+
+bool RouteBuilder::hasStartDistance(int index, int distance, int length,
+                                    const QPoint& start, const QPoint& goal, const QRect& bounds)
+{
+    auto heuristic = [&](int i) {
+        QPoint c = m_grid.cellAt(i);
+        return std::abs(c.x() - goal.x()) + std::abs(c.y() - goal.y());
+    };
+
+    // Узел плато: путь через него не длиннее найденного, не короче
+    // манхэттенского расстояния от старта и не короче уже известного
+    auto onPlateau = [&](int i, int d) {
+        QPoint c = m_grid.cellAt(i);
+        return d + heuristic(i) == length && m_workspace.cost(i) > d
+            && std::abs(c.x() - start.x()) + std::abs(c.y() - start.y()) <= d;
+    };
+
+    // A* к остановке раскрыл все узлы с f меньше длины пути, и их стоимости
+    // точные. Найденная стоимость, равная distance, тоже точная: расстояние до
+    // узла не меньше distance. Остается плато f == length, где узел мог быть не
+    // раскрыт: его проверяет поиск в глубину к старту по соседям плато на 1 ближе.
+    // Подтвержденные узлы получают стоимость, опровергнутые - пометку
+    if (m_workspace.cost(index) == distance)
+        return true;
+    if (m_grid.isBlockedIndex(index) || m_workspace.isMarked(index) || !onPlateau(index, distance))
+        return false;
+
+    const QPoint dirs[4] = {
+        QPoint(1, 0),
+        QPoint(-1, 0),
+        QPoint(0, 1),
+        QPoint(0, -1)
+    };
+
+    // Расстояние узла плато задано эвристикой, а в стеке оно убывает на 1 с
+    // каждым уровнем, поэтому узел не попадает в стек дважды
+    std::vector<int>& stack = m_workspace.queue();
+    stack.clear();
+    stack.push_back(index);
+
+    while (!stack.empty())
+    {
+        const int node = stack.back();
+        const int closer = length - heuristic(node) - 1;
+        const QPoint cell = m_grid.cellAt(node);
+
+        int known = -1;
+        int next = -1;
+        for (auto d : dirs)
+        {
+            QPoint nxt(cell.x() + d.x(), cell.y() + d.y());
+            if (!bounds.contains(nxt)) continue;
+
+            int i = m_grid.indexOf(nxt.x(), nxt.y());
+            if (m_workspace.cost(i) == closer) {
+                known = i;
+                break;
+            }
+            if (next == -1 && !m_grid.isBlockedIndex(i) && !m_workspace.isMarked(i) && onPlateau(i, closer))
+                next = i;
+        }
+
+        if (known != -1) {
+            int parent = known;
+            for (size_t k = stack.size(); k-- > 0; ) {
+                m_workspace.visit(stack[k], length - heuristic(stack[k]), parent);
+                parent = stack[k];
+            }
+            return true;
+        }
+
+        if (next == -1) {
+            m_workspace.mark(node);
+            stack.pop_back();
+        } else {
+            stack.push_back(next);
+        }
+    }
+    return false;
+}
+
+std::vector<QPoint> RouteBuilder::extractPath(int startIndex, int goalIndex, int forwardMeet, int backwardMeet, int step) const
+{
+    std::vector<QPoint> pathGrid;
+    pathGrid.reserve(m_workspace.cost(forwardMeet) + 1 + m_backward.cost(backwardMeet) + 1);
+
+    // От точки встречи к старту по дереву прямого поиска, затем разворот
+    for (int p = forwardMeet; ; p = m_workspace.parent(p)) {
+        QPoint c = m_grid.cellAt(p);
+        pathGrid.push_back(QPoint(c.x() * step, c.y() * step));
+        if (p == startIndex)
+            break;
+    }
+    std::reverse(pathGrid.begin(), pathGrid.end());
+
+    // От точки встречи к цели по дереву обратного поиска
+    for (int p = backwardMeet; ; p = m_backward.parent(p)) {
+        QPoint c = m_grid.cellAt(p);
+        pathGrid.push_back(QPoint(c.x() * step, c.y() * step));
+        if (p == goalIndex)
+            break;
+    }
+    return pathGrid;
+}
+
+std::vector<QPoint> RouteBuilder::extractWeightedPath(int goalState, int step) const
+{
+    const int directionCount = 4;
+
+    // Стоимость пути не равна его длине: узлы считаются отдельным проходом,
+    // чтобы результат выделялся один раз
+    size_t length = 1;
+    for (int s = goalState; m_workspace.parent(s) != s; s = m_workspace.parent(s))
+        ++length;
+
+    std::vector<QPoint> pathGrid;
+    pathGrid.reserve(length);
+    for (int s = goalState; ; s = m_workspace.parent(s)) {
+        QPoint c = m_grid.cellAt(s / directionCount);
+        pathGrid.push_back(QPoint(c.x() * step, c.y() * step));
+        if (m_workspace.parent(s) == s)
+            break;
+    }
+
+    std::reverse(pathGrid.begin(), pathGrid.end());
+    return pathGrid;
+}
@@ -0,0 +1,80 @@
+#include "route_cache.h"
+
+RouteCache::RouteCache(size_t capacity)
+    : m_capacity(capacity)
+    , m_version(0)
+    , m_hits(0)
+    , m_misses(0)
+{
+}
+
+const std::vector<QPoint>* RouteCache::find(const QPoint& start, const QPoint& goal, quint64 version)
+{
+    auto it = m_lookup.find({ start, goal, version });
+    if (it == m_lookup.end()) {
+        ++m_misses;
+        return nullptr;
+    }
+
+    // Найденная запись становится самой свежей
+    m_entries.splice(m_entries.begin(), m_entries, it->second);
+    ++m_hits;
+    return &it->second->path;
+}
+
+void RouteCache::insert(const QPoint& start, const QPoint& goal, quint64 version, const std::vector<QPoint>& path)
+{
+    if (m_capacity == 0)
+        return;
+
+    // Результат для устаревшего набора препятствий больше не пригодится
+    if (version < m_version)
+        return;
+
+    if (version > m_version) {
+        m_entries.clear();
+        m_lookup.clear();
+        m_version = version;
+    }
+
+    Key key{ start, goal, version };
+    auto it = m_lookup.find(key);
+    if (it != m_lookup.end()) {
+        it->second->path = path;
+        m_entries.splice(m_entries.begin(), m_entries, it->second);
+        return;
+    }
+
+    if (m_entries.size() >= m_capacity) {
+        m_lookup.erase(m_entries.back().key);
+        m_entries.pop_back();
+    }
+
+    m_entries.push_front({ key, path });
+    m_lookup[key] = m_entries.begin();
+}
+
+void RouteCache::clear()
+{
+    m_entries.clear();
+    m_lookup.clear();
+}
+
+RouteCache::Stats RouteCache::stats() const
+{
+    Stats result;
+    result.hits = m_hits;
+    result.misses = m_misses;
+    result.size = m_entries.size();
+    result.capacity = m_capacity;
+    return result;
+}
+
+size_t RouteCache::KeyHash::operator()(const Key& key) const
+{
+    quint64 h = key.version;
+    const int coords[4] = { key.start.x(), key.start.y(), key.goal.x(), key.goal.y() };
+    for (int c : coords)
+        h = (h ^ static_cast<quint32>(c)) * 0x100000001b3ULL;
+    return static_cast<size_t>(h ^ (h >> 32));
+}
@@ -0,0 +1,91 @@
+#include "route_cell_index.h"
+#include "occupancy_grid.h"
+#include <algorithm>
+
+RouteCellIndex::RouteCellIndex(int step)
+    : m_step(step)
+{
+}
+
+void RouteCellIndex::insert(const Route& route)
+{
+    quint64 k;
+    for (const QPoint& pt : route.cells()) {
+        if (cellOf(pt, k))
+            m_cells[k].push_back(route.getId());
+    }
+}
+
+void RouteCellIndex::remove(const Route& route)
+{
+    const int routeId = route.getId();
+    quint64 k;
+    for (const QPoint& pt : route.cells()) {
+        if (!cellOf(pt, k))
+            continue;
+
+        auto it = m_cells.find(k);
+        if (it == m_cells.end())
+            continue;
+
+        // Порядок маршрутов в узле не важен
+        std::vector<int>& routes = it->second;
+        auto pos = std::find(routes.begin(), routes.end(), routeId);
+        if (pos != routes.end()) {
+            *pos = routes.back();
+            routes.pop_back();
+        }
+        if (routes.empty())
+            m_cells.erase(it);
+    }
+}
+
+void RouteCellIndex::clear()
+{
+    m_cells.clear();
+}
+
+void RouteCellIndex::collect(const QRect& obstacle, std::unordered_set<int>& routes, int margin) const
+{
+    QRect cells = OccupancyGrid::blockedCells(obstacle, m_step);
+    if (!cells.isValid() || m_cells.empty())
+        return;
+    cells.adjust(-margin, -margin, margin, margin);
+
+    // Большое препятствие дешевле проверить по занятым узлам индекса
+    qint64 area = static_cast<qint64>(cells.width()) * cells.height();
+    if (area <= static_cast<qint64>(m_cells.size())) {
+        for (int gy = cells.top(); gy <= cells.bottom(); ++gy) {
+            for (int gx = cells.left(); gx <= cells.right(); ++gx) {
+                auto it = m_cells.find(key(gx, gy));
+                if (it != m_cells.end())
+                    routes.insert(it->second.begin(), it->second.end());
+            }
+        }
+    } else {
+        for (const auto& entry : m_cells) {
+            QPoint cell(static_cast<int>(static_cast<quint32>(entry.first >> 32)),
+                        static_cast<int>(static_cast<quint32>(entry.first)));
+            if (cells.contains(cell))
+                routes.insert(entry.second.begin(), entry.second.end());
+        }
+    }
+}
+
+size_t RouteCellIndex::cellCount() const
+{
+    return m_cells.size();
+}
+
+bool RouteCellIndex::cellOf(const QPoint& pt, quint64& k) const
+{
+    if (pt.x() % m_step != 0 || pt.y() % m_step != 0)
+        return false;
+    k = key(pt.x() / m_step, pt.y() / m_step);
+    return true;
+}
+
+quint64 RouteCellIndex::key(int gx, int gy)
+{
+    return (static_cast<quint64>(static_cast<quint32>(gx)) << 32) | static_cast<quint32>(gy);
+}
@@ -0,0 +1,58 @@
+#include "route_paths.h"
+
+RoutePaths::RoutePaths()
+    : m_offsets(1, 0)
+{
+}
+
+void RoutePaths::clear()
+{
+    m_points.clear();
+    m_offsets.assign(1, 0);
+    m_bounds.clear();
+}
+
+void RoutePaths::reserve(size_t routeCount, size_t pointCount)
+{
+    m_offsets.reserve(routeCount + 1);
+    m_bounds.reserve(routeCount);
+    m_points.reserve(pointCount);
+}
+
+void RoutePaths::append(const std::vector<QPoint>& path)
+{
+    m_points.insert(m_points.end(), path.begin(), path.end());
+    m_offsets.push_back(static_cast<int>(m_points.size()));
+    
+    // Ограничивающий прямоугольник нужен для отсечения невидимых маршрутов
+    QRect bounds;
+    for (const QPoint& pt : path)
+        bounds |= QRect(pt, pt);
+    m_bounds.push_back(bounds);
+}
+
+size_t RoutePaths::count() const
+{
+    return m_offsets.size() - 1;
+}
+
+RoutePaths::PathView RoutePaths::path(size_t index) const
+{
+    int begin = m_offsets[index];
+    return { m_points.data() + begin, m_offsets[index + 1] - begin };
+}
+
+QRect RoutePaths::bounds(size_t index) const
+{
+    return m_bounds[index];
+}
+
+const std::vector<QPoint>& RoutePaths::points() const
+{
+    return m_points;
+}
+
+const std::vector<int>& RoutePaths::offsets() const
+{
+    return m_offsets;
+}
@@ -0,0 +1,172 @@
+#include "routing_stats.h"
+#include <algorithm>
+#include <cmath>
+
+LatencyHistogram::LatencyHistogram()
+{
+    reset();
+}
+
+void LatencyHistogram::record(quint64 micros, quint64 count)
+{
+    m_buckets[bucketOf(micros)].fetch_add(count, std::memory_order_relaxed);
+}
+
+void LatencyHistogram::reset()
+{
+    for (auto& bucket : m_buckets)
+        bucket.store(0, std::memory_order_relaxed);
+}
+
+quint64 LatencyHistogram::count() const
+{
+    quint64 total = 0;
+    for (const auto& bucket : m_buckets)
+        total += bucket.load(std::memory_order_relaxed);
+    return total;
+}
+
+quint64 LatencyHistogram::percentile(double fraction) const
+{
+    quint64 counts[BucketCount];
+    quint64 total = 0;
+    for (int i = 0; i < BucketCount; ++i) {
+        counts[i] = m_buckets[i].load(std::memory_order_relaxed);
+        total += counts[i];
+    }
+    if (total == 0)
+        return 0;
+
+    // Номер записи (с единицы), на которую приходится перцентиль
+    fraction = std::min(std::max(fraction, 0.0), 1.0);
+    quint64 rank = std::max<quint64>(1, static_cast<quint64>(std::ceil(fraction * total)));
+
+    quint64 seen = 0;
+    for (int i = 0; i < BucketCount; ++i) {
+        seen += counts[i];
+        if (seen >= rank)
+            return upperBound(i);
+    }
+    return upperBound(BucketCount - 1);
+}
+
+int LatencyHistogram::bucketOf(quint64 value)
+{
+    const quint64 subBuckets = 1u << SubBucketBits;
+    if (value < subBuckets)
+        return static_cast<int>(value);
+
+    // Старший бит задает степень двойки, следующие SubBucketBits - корзину в ней
+    int msb = 0;
+    for (quint64 v = value; v > 1; v >>= 1)
+        ++msb;
+    int sub = static_cast<int>((value >> (msb - SubBucketBits)) & (subBuckets - 1));
+    return ((msb - SubBucketBits + 1) << SubBucketBits) + sub;
+}
+
+quint64 LatencyHistogram::upperBound(int bucket)
+{
+    const int subBuckets = 1 << SubBucketBits;
+    if (bucket < subBuckets)
+        return static_cast<quint64>(bucket);
+
+    int msb = (bucket >> SubBucketBits) + SubBucketBits - 1;
+    quint64 sub = static_cast<quint64>(bucket & (subBuckets - 1));
+    quint64 width = quint64(1) << (msb - SubBucketBits);
+    return ((subBuckets + sub) << (msb - SubBucketBits)) + width - 1;
+}
+
+RoutingStats::RoutingStats()
+{
+    reset();
+}
+
+void RoutingStats::recordSearch(const SearchStats& search, int routeCount, quint64 pathPoints, quint64 micros)
+{
+    m_searches.fetch_add(1, std::memory_order_relaxed);
+    m_routesSearched.fetch_add(routeCount, std::memory_order_relaxed);
+    if (!search.reached)
+        m_unreachable.fetch_add(1, std::memory_order_relaxed);
+    m_nodesExpanded.fetch_add(search.nodesExpanded, std::memory_order_relaxed);
+    m_pathPoints.fetch_add(pathPoints, std::memory_order_relaxed);
+    updateMax(m_openListPeak, search.openListPeak);
+
+    // Пакет с общим деревом поиска не делится на отдельные поиски: каждому
+    // маршруту приписывается среднее время, иначе перцентили смешивали бы
+    // время одного маршрута и целого пакета
+    const quint64 routes = static_cast<quint64>(std::max(routeCount, 1));
+    const quint64 perRoute = (micros + routes / 2) / routes;
+    updateMax(m_searchTimeMax, perRoute);
+    m_searchTime.record(perRoute, routes);
+}
+
+void RoutingStats::recordRebuild(int replanned, int repaired, quint64 micros)
+{
+    m_rebuilds.fetch_add(1, std::memory_order_relaxed);
+    m_routesReplanned.fetch_add(replanned, std::memory_order_relaxed);
+    m_routesRepaired.fetch_add(repaired, std::memory_order_relaxed);
+    m_lastRebuildRoutes.store(replanned + repaired, std::memory_order_relaxed);
+    m_rebuildTime.record(micros);
+}
+
+void RoutingStats::recordCacheHits(int count)
+{
+    m_routesFromCache.fetch_add(count, std::memory_order_relaxed);
+}
+
+RoutingStats::Snapshot RoutingStats::snapshot() const
+{
+    Snapshot s;
+    s.enabled = Enabled;
+
+    s.searches = m_searches.load(std::memory_order_relaxed);
+    s.routesSearched = m_routesSearched.load(std::memory_order_relaxed);
+    s.unreachable = m_unreachable.load(std::memory_order_relaxed);
+    s.nodesExpanded = m_nodesExpanded.load(std::memory_order_relaxed);
+    s.pathPoints = m_pathPoints.load(std::memory_order_relaxed);
+    s.openListPeak = m_openListPeak.load(std::memory_order_relaxed);
+    s.searchTimeP50 = m_searchTime.percentile(0.5);
+    s.searchTimeP99 = m_searchTime.percentile(0.99);
+    s.searchTimeMax = m_searchTimeMax.load(std::memory_order_relaxed);
+
+    s.rebuilds = m_rebuilds.load(std::memory_order_relaxed);
+    s.routesReplanned = m_routesReplanned.load(std::memory_order_relaxed);
+    s.routesRepaired = m_routesRepaired.load(std::memory_order_relaxed);
+    s.routesFromCache = m_routesFromCache.load(std::memory_order_relaxed);
+    s.lastRebuildRoutes = m_lastRebuildRoutes.load(std::memory_order_relaxed);
+    s.rebuildTimeP99 = m_rebuildTime.percentile(0.99);
+    return s;
+}
+
+void RoutingStats::reset()
+{
+    m_searches.store(0, std::memory_order_relaxed);
+    m_routesSearched.store(0, std::memory_order_relaxed);
+    m_unreachable.store(0, std::memory_order_relaxed);
+    m_nodesExpanded.store(0, std::memory_order_relaxed);
+    m_pathPoints.store(0, std::memory_order_relaxed);
+    m_openListPeak.store(0, std::memory_order_relaxed);
+    m_searchTimeMax.store(0, std::memory_order_relaxed);
+    m_searchTime.reset();
+
+    m_rebuilds.store(0, std::memory_order_relaxed);
+    m_routesReplanned.store(0, std::memory_order_relaxed);
+    m_routesRepaired.store(0, std::memory_order_relaxed);
+    m_routesFromCache.store(0, std::memory_order_relaxed);
+    m_lastRebuildRoutes.store(0, std::memory_order_relaxed);
+    m_rebuildTime.reset();
+}
+
+void RoutingStats::updateMax(std::atomic<int>& target, int value)
+{
+    int current = target.load(std::memory_order_relaxed);
+    while (current < value && !target.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+    }
+}
+
+void RoutingStats::updateMax(std::atomic<quint64>& target, quint64 value)
+{
+    quint64 current = target.load(std::memory_order_relaxed);
+    while (current < value && !target.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+    }
+}
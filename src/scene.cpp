@@ -1,175 +1,537 @@
 #include "scene.h"
+#include "instrumented_route_builder.h"
+#include "occupancy_grid.h"
 #include <algorithm>
+#include <atomic>
+#include <cstdlib>
 #include <memory>
+#include <QThread>
 
 Scene::Scene(std::unique_ptr<IElementManager> elementManager, 
-             std::unique_ptr<IRouteBuilder> routeBuilder)
+             std::unique_ptr<IRouteBuilder> routeBuilder,
+             const GridSettings& settings)
     : m_elementManager(std::move(elementManager))
     , m_routeBuilder(std::move(routeBuilder))
-    , m_cellSize(25)
+    , m_obstaclesVersion(0)
+    , m_routeCache(4096)
+    , m_gridSettings(settings)
+    , m_obstacleIndex(m_gridSettings.cellSize)
+    , m_pointIndex(m_gridSettings.cellSize)
+    , m_routeCells(m_gridSettings.cellSize)
+    , m_nextElementId(0)
+    , m_nextRouteId(0)
+    , m_batchDepth(0)
+    , m_batchObstaclesChanged(false)
+    , m_batchRebuildRequested(false)
+    , m_repairTick(0)
+    , m_rebuildThreadCount(QThread::idealThreadCount())
 {
+    // Копии построителя для потоков получаются из обертки и пишут в те же счетчики
+    if (RoutingStats::Enabled)
+        m_routeBuilder = std::make_unique<InstrumentedRouteBuilder>(std::move(m_routeBuilder), &m_routingStats);
+    
+    m_asyncPlanner = std::make_unique<AsyncRoutePlanner>(
+        m_routeBuilder->clone(),
+        [this](const AsyncRoutePlanner::Result& result) {
+            applyPlannedRoutes(result);
+        });
 }
 
 int Scene::addPoint(const QPoint& position)
 {
-    static int nextId = 0;
-    int id = nextId++;
-    
-    auto point = std::make_unique<Point>(id, position);
-    m_elementManager->addElement(std::move(point));
+    int id = m_nextElementId++;
+    m_elementManager->addPoint(id, position);
+    m_pointIndex.insert(id, position);
     
     return id;
 }
 
-void Scene::addObstacle(const QRect& bounds)
+int Scene::addObstacle(const QRect& bounds)
 {
-    static int nextId = 1000; // Отдельная нумерация для препятствий
-    int id = nextId++;
+    int id = m_nextElementId++;
+    m_elementManager->addObstacle(id, bounds);
     
-    auto obstacle = std::make_unique<Obstacle>(id, bounds);
-    m_elementManager->addElement(std::move(obstacle));
+    m_obstacleIndex.insert(id, bounds);
+    if (!m_routes.empty())
+        m_addedObstacles.append(bounds);
+    markObstaclesChanged({ bounds }, {});
     
-    m_obstacles.push_back(bounds);
+    return id;
 }
 
 void Scene::removeElement(int id)
 {
+    // Удалить препятствие, если это препятствие
+    QRect bounds;
+    if (m_elementManager->getObstacleBounds(id, bounds)) {
+        m_obstacleIndex.remove(id);
+        if (!m_routes.empty())
+            m_removedObstacles.append(bounds);
+        markObstaclesChanged({}, { bounds });
+    }
+    
+    QPoint position;
+    if (m_elementManager->getPointPosition(id, position)) {
+        m_pointIndex.remove(id, position);
+    }
+    
     m_elementManager->removeElement(id);
+}
+
+bool Scene::movePoint(int id, const QPoint& position)
+{
+    QPoint current;
+    if (!m_elementManager->getPointPosition(id, current)) {
+        return false;
+    }
     
-    // Удалить препятствие, если это препятствие
-    m_obstacles.erase(
-        std::remove_if(m_obstacles.begin(), m_obstacles.end(),
-            [id](const QRect& rect) {
-                // Временно: упрощенная проверка
-                return false;
-            }),
-        m_obstacles.end()
-    );
+    if (current != position) {
+        m_elementManager->setPointPosition(id, position);
+        m_pointIndex.move(id, current, position);
+        m_movedPoints.insert(id);
+    }
+    
+    return true;
+}
+
+int Scene::addPoints(const std::vector<QPoint>& positions)
+{
+    int firstId = m_nextElementId;
+    m_nextElementId += static_cast<int>(positions.size());
+    m_elementManager->addPoints(firstId, positions);
+    m_pointIndex.reserve(positions.size());
+    
+    for (size_t i = 0; i < positions.size(); ++i)
+        m_pointIndex.insert(firstId + static_cast<int>(i), positions[i]);
+    
+    return firstId;
+}
+
+int Scene::addObstacles(const std::vector<QRect>& bounds)
+{
+    int firstId = m_nextElementId;
+    m_nextElementId += static_cast<int>(bounds.size());
+    m_elementManager->addObstacles(firstId, bounds);
+    m_obstacleIndex.reserve(bounds.size());
+    
+    // Новые препятствия проверяются только против существующих маршрутов
+    for (size_t i = 0; i < bounds.size(); ++i) {
+        m_obstacleIndex.insert(firstId + static_cast<int>(i), bounds[i]);
+        if (!m_routes.empty())
+            m_addedObstacles.append(bounds[i]);
+    }
+    
+    // Один пакет - одна версия препятствий
+    if (!bounds.empty())
+        markObstaclesChanged(bounds, {});
+    
+    return firstId;
+}
+
+void Scene::beginBatch()
+{
+    ++m_batchDepth;
+}
+
+void Scene::commitBatch()
+{
+    if (m_batchDepth == 0 || --m_batchDepth > 0)
+        return;
+    
+    if (m_batchObstaclesChanged)
+        ++m_obstaclesVersion;
+    m_batchObstaclesChanged = false;
+    
+    // Все изменения пакета - одно перестроение затронутых маршрутов
+    bool rebuild = m_batchRebuildRequested || hasPendingChanges();
+    m_batchRebuildRequested = false;
+    if (rebuild)
+        rebuildRoutes();
 }
 
-IElement* Scene::getElement(int id)
+bool Scene::getPointPosition(int id, QPoint& position) const
 {
-    return m_elementManager->getElement(id);
+    return m_elementManager->getPointPosition(id, position);
 }
 
-const std::vector<std::unique_ptr<IElement>>& Scene::getAllElements() const
+const std::vector<int>& Scene::getPointIds() const
 {
-    return m_elementManager->getAllElements();
+    return m_elementManager->getPointIds();
 }
 
-std::vector<IElement*> Scene::getAllElementsPtr()
+const std::vector<QPoint>& Scene::getPointPositions() const
 {
-    return m_elementManager->getAllElementsPtr();
+    return m_elementManager->getPointPositions();
+}
+
+int Scene::pickPoint(const QPoint& worldPos, int radius) const
+{
+    return m_pointIndex.pick(worldPos, radius);
 }
 
 const std::vector<QRect>& Scene::getObstacles() const
 {
-    return m_obstacles;
+    return obstacles();
+}
+
+quint64 Scene::getObstaclesVersion() const
+{
+    return m_obstaclesVersion;
 }
 
 bool Scene::buildRoute(int startId, int endId)
 {
-    IElement* startElement = m_elementManager->getElement(startId);
-    IElement* endElement = m_elementManager->getElement(endId);
-    
-    if (!startElement || !endElement) {
+    // Проверяем, что оба элемента - точки
+    QPoint startPos;
+    QPoint endPos;
+    if (!getPointPosition(startId, startPos) || !getPointPosition(endId, endPos)) {
         return false;
     }
     
-    // Проверяем, что оба элемента - точки
-    Point* startPoint = dynamic_cast<Point*>(startElement);
-    Point* endPoint = dynamic_cast<Point*>(endElement);
+    // Внутри пакета с измененными препятствиями версия еще не сменилась,
+    // поэтому кэш по ней не используется
+    std::vector<QPoint> path;
+    const std::vector<QPoint>* cached = nullptr;
+    if (!m_batchObstaclesChanged)
+        cached = m_routeCache.find(startPos, endPos, m_obstaclesVersion);
     
-    if (!startPoint || !endPoint) {
-        return false;
+    if (cached) {
+        path = *cached;
+        if (RoutingStats::Enabled)
+            m_routingStats.recordCacheHits(1);
+    } else {
+        path = m_routeBuilder->buildRoute(startPos, endPos, obstacles());
+        if (!m_batchObstaclesChanged)
+            m_routeCache.insert(startPos, endPos, m_obstaclesVersion, path);
     }
     
-    std::vector<QPoint> path = m_routeBuilder->buildRoute(
-        startPoint->getPosition(),
-        endPoint->getPosition(),
-        m_obstacles
-    );
-    
     if (!path.empty()) {
-        Route route(m_routes.size(), startId, endId);
-        route.setPath(path);
-        m_routes.push_back(route);
+        Route route(m_nextRouteId++, startId, endId);
+        route.setPath(std::move(path));
+        m_routes.push_back(std::move(route));
+        m_routeCells.insert(m_routes.back());
+        refreshRoutePaths();
         return true;
     }
     
     return false;
 }
 
-const std::vector<std::vector<QPoint>>& Scene::getRoutes() const
+const RoutePaths& Scene::getRoutes() const
+{
+    return m_routePaths;
+}
+
+const std::vector<Route>& Scene::getRouteList() const
+{
+    return m_routes;
+}
+
+bool Scene::addRoute(int startId, int endId, const std::vector<QPoint>& path)
 {
-    // Преобразуем маршруты в вектор путей
-    static std::vector<std::vector<QPoint>> paths;
-    paths.clear();
+    QPoint startPos;
+    QPoint endPos;
+    if (!getPointPosition(startId, startPos) || !getPointPosition(endId, endPos)) {
+        return false;
+    }
     
-    for (const auto& route : m_routes) {
-        paths.push_back(route.getPath());
+    Route route(m_nextRouteId++, startId, endId);
+    route.setPath(path);
+    m_routes.push_back(std::move(route));
+    m_routeCells.insert(m_routes.back());
+    
+    // Новый маршрут последний в списке: дописываем его путь без пересборки остальных
+    m_routePaths.append(m_routes.back().getCorners());
+    m_dirtyRect |= m_routePaths.bounds(m_routePaths.count() - 1);
+    return true;
+}
+
+size_t Scene::addRoutes(const std::vector<int>& endpointIds, const std::vector<QPoint>& pathPoints,
+                        const std::vector<quint64>& pathOffsets)
+{
+    const size_t routeCount = endpointIds.size() / 2;
+    if (routeCount == 0 || pathOffsets.size() != routeCount + 1)
+        return 0;
+    
+    const size_t firstNew = m_routes.size();
+    m_routes.reserve(firstNew + routeCount);
+    
+    std::vector<QPoint> path;
+    for (size_t i = 0; i < routeCount; ++i) {
+        const int startId = endpointIds[2 * i];
+        const int endId = endpointIds[2 * i + 1];
+        QPoint pos;
+        if (!getPointPosition(startId, pos) || !getPointPosition(endId, pos))
+            continue;
+        if (pathOffsets[i] > pathOffsets[i + 1] || pathOffsets[i + 1] > pathPoints.size())
+            continue;
+        
+        // Буфер пути общий для всех маршрутов пакета
+        path.assign(pathPoints.begin() + pathOffsets[i], pathPoints.begin() + pathOffsets[i + 1]);
+        Route route(m_nextRouteId++, startId, endId);
+        route.setPath(path);
+        m_routes.push_back(std::move(route));
+        m_routeCells.insert(m_routes.back());
+    }
+    
+    // Пути новых маршрутов дописываются в буфер отрисовки за один проход
+    size_t pointCount = m_routePaths.points().size();
+    for (size_t i = firstNew; i < m_routes.size(); ++i)
+        pointCount += m_routes[i].getCorners().size();
+    m_routePaths.reserve(m_routes.size(), pointCount);
+    for (size_t i = firstNew; i < m_routes.size(); ++i) {
+        m_routePaths.append(m_routes[i].getCorners());
+        m_dirtyRect |= m_routePaths.bounds(i);
     }
     
-    return paths;
+    return m_routes.size() - firstNew;
 }
 
 void Scene::removeRoutesWithPoint(int pointId)
 {
+    for (const auto& route : findRoutesWithPoint(pointId)) {
+        m_repairSlots.erase(route.getId());
+    }
+    
     m_routes.erase(
         std::remove_if(m_routes.begin(), m_routes.end(),
-            [pointId](const Route& route) {
-                return route.getStartId() == pointId || route.getEndId() == pointId;
+            [this, pointId](const Route& route) {
+                if (route.getStartId() != pointId && route.getEndId() != pointId)
+                    return false;
+                m_routeCells.remove(route);
+                return true;
             }),
         m_routes.end()
     );
+    
+    refreshRoutePaths();
 }
 
 void Scene::rebuildRoutes()
 {
-    // Перестраиваем все маршруты
-    std::vector<Route> newRoutes;
+    if (m_batchDepth > 0) {
+        m_batchRebuildRequested = true;
+        return;
+    }
     
-    for (const auto& route : m_routes) {
-        IElement* startElement = m_elementManager->getElement(route.getStartId());
-        IElement* endElement = m_elementManager->getElement(route.getEndId());
+    QElapsedTimer timer;
+    if (RoutingStats::Enabled)
+        timer.start();
+    
+    // Синхронное перестроение заменяет незавершенное асинхронное
+    m_asyncPlanner->cancel();
+    removeDanglingRoutes();
+    
+    // Перестраиваем только маршруты, затронутые изменениями
+    std::unordered_set<int> affected = collectAffectedRoutes();
+    std::vector<Route*> replans;
+    size_t affectedCount = 0;
+    int cacheHits = 0;
+    int repaired = 0;
+    for (auto& route : m_routes) {
+        if (!affected.count(route.getId()))
+            continue;
+        ++affectedCount;
         
-        if (startElement && endElement) {
-            Point* startPoint = dynamic_cast<Point*>(startElement);
-            Point* endPoint = dynamic_cast<Point*>(endElement);
-            
-            if (startPoint && endPoint) {
-                std::vector<QPoint> path = m_routeBuilder->buildRoute(
-                    startPoint->getPosition(),
-                    endPoint->getPosition(),
-                    m_obstacles
-                );
-                
-                if (!path.empty()) {
-                    Route newRoute(newRoutes.size(), route.getStartId(), route.getEndId());
-                    newRoute.setPath(path);
-                    newRoutes.push_back(newRoute);
-                }
-            }
+        QPoint startPos;
+        QPoint endPos;
+        getPointPosition(route.getStartId(), startPos);
+        getPointPosition(route.getEndId(), endPos);
+        
+        // Те же концы при том же наборе препятствий - путь уже известен
+        if (const std::vector<QPoint>* cached = m_routeCache.find(startPos, endPos, m_obstaclesVersion)) {
+            setRoutePath(route, *cached);
+            ++cacheHits;
+            continue;
+        }
+        
+        // Инкрементальный планировщик ищет пути только с равноценными шагами
+        bool endpointMoved = m_movedPoints.count(route.getStartId()) || m_movedPoints.count(route.getEndId());
+        bool repairable = endpointMoved || m_repairSlots.count(route.getId());
+        if (repairable && m_gridSettings.isUniform()) {
+            // Починенный путь в кэш не попадает: кэш хранит пути построителя
+            // сцены, а у JPS и HPA* выбор из равных по длине путей другой
+            setRoutePath(route, repairRoute(route, startPos, endPos));
+            ++repaired;
+        } else {
+            replans.push_back(&route);
+        }
+    }
+    
+    replanRoutes(replans);
+    
+    m_movedPoints.clear();
+    m_addedObstacles.clear();
+    m_removedObstacles.clear();
+    m_pendingRoutes.clear();
+    
+    if (affectedCount > 0)
+        refreshRoutePaths();
+    
+    if (RoutingStats::Enabled && affectedCount > 0) {
+        m_routingStats.recordCacheHits(cacheHits);
+        m_routingStats.recordRebuild(static_cast<int>(replans.size()), repaired,
+                                     static_cast<quint64>(timer.nsecsElapsed() / 1000));
+    }
+}
+
+void Scene::requestRouteRebuild()
+{
+    if (m_batchDepth > 0) {
+        m_batchRebuildRequested = true;
+        return;
+    }
+    
+    if (!hasPendingChanges())
+        return;
+    
+    QElapsedTimer timer;
+    if (RoutingStats::Enabled)
+        timer.start();
+    
+    removeDanglingRoutes();
+    
+    // Новое задание включает и маршруты из отменяемого незавершенного
+    for (int routeId : collectAffectedRoutes())
+        m_pendingRoutes.insert(routeId);
+    
+    std::set<int> movedPoints;
+    std::swap(movedPoints, m_movedPoints);
+    m_addedObstacles.clear();
+    m_removedObstacles.clear();
+    
+    if (m_pendingRoutes.empty())
+        return;
+    
+    AsyncRoutePlanner::Job job;
+    job.obstaclesVersion = m_obstaclesVersion;
+    int cacheHits = 0;
+    int repaired = 0;
+    for (auto& route : m_routes) {
+        if (!m_pendingRoutes.count(route.getId()))
+            continue;
+        
+        RouteEndpoints endpoints;
+        getPointPosition(route.getStartId(), endpoints.first);
+        getPointPosition(route.getEndId(), endpoints.second);
+        
+        // Маршруты из кэша применяются сразу, без фонового задания
+        if (const std::vector<QPoint>* cached = m_routeCache.find(endpoints.first, endpoints.second, m_obstaclesVersion)) {
+            setRoutePath(route, *cached);
+            m_pendingRoutes.erase(route.getId());
+            ++cacheHits;
+            continue;
         }
+        
+        // Маршрут с перемещенным концом чинится сразу, как в rebuildRoutes:
+        // дерево поиска с прошлого шага перетаскивания переиспользуется,
+        // и фоновый поиск с нуля для него не нужен
+        bool endpointMoved = movedPoints.count(route.getStartId()) || movedPoints.count(route.getEndId());
+        bool repairable = endpointMoved || m_repairSlots.count(route.getId());
+        if (repairable && m_gridSettings.isUniform()) {
+            setRoutePath(route, repairRoute(route, endpoints.first, endpoints.second));
+            m_pendingRoutes.erase(route.getId());
+            ++repaired;
+            continue;
+        }
+        
+        job.routeIds.push_back(route.getId());
+        job.endpoints.push_back(endpoints);
+    }
+    
+    if (job.routeIds.empty()) {
+        m_asyncPlanner->cancel();
+    } else {
+        job.obstacles = obstacles();
+        m_asyncPlanner->submit(std::move(job));
+        
+        // Время перестроения - от запроса до применения результата
+        if (RoutingStats::Enabled)
+            m_asyncRebuildTimer.start();
+    }
+    
+    if (RoutingStats::Enabled) {
+        m_routingStats.recordCacheHits(cacheHits);
+        if (repaired > 0)
+            m_routingStats.recordRebuild(0, repaired, static_cast<quint64>(timer.nsecsElapsed() / 1000));
     }
     
-    m_routes = std::move(newRoutes);
+    if (cacheHits > 0 || repaired > 0) {
+        refreshRoutePaths();
+        if (m_routesUpdatedHandler)
+            m_routesUpdatedHandler();
+    }
+}
+
+void Scene::setRoutesUpdatedHandler(std::function<void()> handler)
+{
+    m_routesUpdatedHandler = std::move(handler);
+}
+
+QRect Scene::takeDirtyRect()
+{
+    QRect dirty = m_dirtyRect;
+    m_dirtyRect = QRect();
+    return dirty;
+}
+
+void Scene::setRebuildThreadCount(int count)
+{
+    m_rebuildThreadCount = std::max(1, count);
+}
+
+RouteCache::Stats Scene::getRouteCacheStats() const
+{
+    return m_routeCache.stats();
+}
+
+RoutingStats::Snapshot Scene::getRoutingStats() const
+{
+    return m_routingStats.snapshot();
+}
+
+void Scene::resetRoutingStats()
+{
+    m_routingStats.reset();
+}
+
+const GridSettings& Scene::getGridSettings() const
+{
+    return m_gridSettings;
 }
 
 QPoint Scene::snapToGrid(const QPoint& p) const
 {
-    int x = (p.x() + m_cellSize / 2) / m_cellSize * m_cellSize;
-    int y = (p.y() + m_cellSize / 2) / m_cellSize * m_cellSize;
-    return QPoint(x, y);
+    // Округление к ближайшему узлу и для отрицательных координат: деление
+    // с отбрасыванием дробной части сдвигало бы уже привязанные точки
+    const int cellSize = m_gridSettings.cellSize;
+    QPoint cell = OccupancyGrid::toCell(p + QPoint(cellSize / 2, cellSize / 2), cellSize);
+    return QPoint(cell.x() * cellSize, cell.y() * cellSize);
 }
 
 bool Scene::isInsideBlockedCell(const QPoint& pt) const
 {
-    for (const QRect& rc : m_obstacles) {
-        if (rc.contains(pt))
-            return true;
-    }
-    return false;
+    return m_obstacleIndex.containsPoint(pt);
+}
+
+void Scene::markObstaclesChanged(const std::vector<QRect>& added, const std::vector<QRect>& removed)
+{
+    // Построители сразу узнают об изменении: запросы идут и внутри пакета.
+    // Копии фонового планировщика живут в другом потоке и сверяют наборы сами
+    m_routeBuilder->obstaclesChanged(added, removed);
+    for (const auto& builder : m_workerBuilders)
+        builder->obstaclesChanged(added, removed);
+    
+    // В пакете версия меняется один раз, при commitBatch
+    if (m_batchDepth > 0)
+        m_batchObstaclesChanged = true;
+    else
+        ++m_obstaclesVersion;
+}
+
+bool Scene::hasPendingChanges() const
+{
+    return !m_movedPoints.empty() || !m_addedObstacles.empty() || !m_removedObstacles.empty();
 }
 
 std::vector<Route> Scene::findRoutesWithPoint(int pointId)
@@ -183,4 +545,253 @@ std::vector<Route> Scene::findRoutesWithPoint(int pointId)
     }
     
     return result;
+}
+
+const std::vector<QRect>& Scene::obstacles() const
+{
+    return m_elementManager->getObstacleBounds();
+}
+
+std::unordered_set<int> Scene::collectAffectedRoutes() const
+{
+    std::unordered_set<int> affected(m_pendingRoutes.begin(), m_pendingRoutes.end());
+    
+    // Новое препятствие влияет только на маршруты через заблокированные им узлы,
+    // а при неравных стоимостях шагов - и через соседние, ставшие дороже
+    const int margin = m_gridSettings.isUniform() ? 0 : 1;
+    for (size_t i = 0; i < m_addedObstacles.size(); ++i)
+        m_routeCells.collect(m_addedObstacles.at(i), affected, margin);
+    
+    if (m_movedPoints.empty() && m_removedObstacles.empty())
+        return affected;
+    
+    for (const auto& route : m_routes) {
+        if (m_movedPoints.count(route.getStartId()) || m_movedPoints.count(route.getEndId())
+            || canRemovalShorten(route))
+            affected.insert(route.getId());
+    }
+    
+    return affected;
+}
+
+bool Scene::canRemovalShorten(const Route& route) const
+{
+    if (m_removedObstacles.empty())
+        return false;
+    
+    Route::Cells path = route.cells();
+    QPoint start = OccupancyGrid::toCell(path.front(), m_gridSettings.cellSize);
+    QPoint end = OccupancyGrid::toCell(path.back(), m_gridSettings.cellSize);
+    
+    // Недостижимый маршрут хранится отрезком между концами: удаление может открыть путь
+    int distance = std::abs(start.x() - end.x()) + std::abs(start.y() - end.y());
+    if (path.size() == 2 && distance != 1)
+        return true;
+    
+    // Более дешевый путь должен пройти через узел c, цена которого изменилась:
+    // освободившийся, а при неравных стоимостях шагов и соседний с ним. Поэтому
+    // его цена не меньше stepCost * (|start - c| + |c - end|). По каждой оси минимум -
+    // расстояние между концами плюс двойной выход за их диапазон до прямоугольника
+    const GridSettings& grid = m_gridSettings;
+    const int margin = grid.isUniform() ? 0 : 1;
+    
+    // Цена текущего пути не больше, чем если бы каждый шаг шел рядом с препятствием,
+    // а в каждой промежуточной точке поворота путь поворачивал
+    const qint64 length = static_cast<qint64>(path.size()) - 1;
+    const qint64 turns = std::max<qint64>(0, static_cast<qint64>(route.getCorners().size()) - 2);
+    const qint64 cost = length * (grid.stepCost + grid.nearObstacleCost) + turns * grid.turnCost;
+    
+    auto detour = [](int a, int b, int lo, int hi) {
+        int from = std::min(a, b);
+        int to = std::max(a, b);
+        return 2 * (std::max(0, lo - to) + std::max(0, from - hi));
+    };
+    
+    for (size_t i = 0; i < m_removedObstacles.size(); ++i) {
+        QRect cells = OccupancyGrid::blockedCells(m_removedObstacles.at(i), grid.cellSize);
+        if (!cells.isValid())
+            continue;
+        cells.adjust(-margin, -margin, margin, margin);
+        
+        qint64 bound = distance
+            + detour(start.x(), end.x(), cells.left(), cells.right())
+            + detour(start.y(), end.y(), cells.top(), cells.bottom());
+        if (bound * grid.stepCost < cost)
+            return true;
+    }
+    
+    return false;
+}
+
+void Scene::setRoutePath(Route& route, std::vector<QPoint> path)
+{
+    m_routeCells.remove(route);
+    route.setPath(std::move(path));
+    m_routeCells.insert(route);
+}
+
+std::vector<QPoint> Scene::repairRoute(const Route& route, const QPoint& start, const QPoint& end)
+{
+    const size_t maxRepairSlots = 8;
+    
+    // Храним деревья поиска только для недавно перестраиваемых маршрутов
+    if (!m_repairSlots.count(route.getId()) && m_repairSlots.size() >= maxRepairSlots) {
+        auto oldest = std::min_element(m_repairSlots.begin(), m_repairSlots.end(),
+            [](const auto& lhs, const auto& rhs) {
+                return lhs.second.lastUsed < rhs.second.lastUsed;
+            });
+        m_repairSlots.erase(oldest);
+    }
+    
+    RepairSlot& slot = m_repairSlots[route.getId()];
+    if (!slot.planner)
+        slot.planner = std::make_unique<IncrementalPlanner>(m_gridSettings.cellSize);
+    slot.lastUsed = ++m_repairTick;
+    
+    std::vector<QPoint> path;
+    if (slot.planner->plan(start, end, obstacles(), path))
+        return path;
+    
+    return m_routeBuilder->buildRoute(start, end, obstacles());
+}
+
+void Scene::replanRoutes(const std::vector<Route*>& routes)
+{
+    // Минимальное число маршрутов на поток, при котором параллельность окупается
+    const size_t minRoutesPerWorker = 4;
+    
+    // Снимок концов маршрутов: потоки только читают его и список препятствий
+    std::vector<RouteEndpoints> endpoints(routes.size());
+    for (size_t i = 0; i < routes.size(); ++i) {
+        getPointPosition(routes[i]->getStartId(), endpoints[i].first);
+        getPointPosition(routes[i]->getEndId(), endpoints[i].second);
+    }
+    
+    const std::vector<QRect>& obstacleList = obstacles();
+    std::vector<std::vector<QPoint>> paths;
+    
+    // Маршруты с общим стартом строятся по одному дереву поиска,
+    // поэтому потокам раздаются целые группы
+    std::vector<std::vector<int>> groups = RouteBatch::groupBySource(endpoints);
+    size_t workers = std::min<size_t>(m_rebuildThreadCount, routes.size() / minRoutesPerWorker);
+    workers = std::min(workers, groups.size());
+    
+    if (workers <= 1) {
+        paths = m_routeBuilder->buildRoutes(endpoints, obstacleList);
+    } else {
+        paths.resize(routes.size());
+        while (m_workerBuilders.size() < workers)
+            m_workerBuilders.push_back(m_routeBuilder->clone());
+        m_rebuildPool.setMaxThreadCount(static_cast<int>(workers));
+        
+        // Группы раздаются потокам по одной; результат пишется по индексу
+        // маршрута, поэтому порядок совпадает с последовательным перестроением
+        std::atomic<size_t> next(0);
+        for (size_t w = 0; w < workers; ++w) {
+            IRouteBuilder* builder = m_workerBuilders[w].get();
+            m_rebuildPool.start([&, builder]() {
+                std::vector<RouteEndpoints> batch;
+                for (size_t g = next++; g < groups.size(); g = next++) {
+                    batch.clear();
+                    for (int i : groups[g])
+                        batch.push_back(endpoints[i]);
+                    
+                    std::vector<std::vector<QPoint>> result = builder->buildRoutes(batch, obstacleList);
+                    for (size_t k = 0; k < result.size(); ++k)
+                        paths[groups[g][k]] = std::move(result[k]);
+                }
+            });
+        }
+        m_rebuildPool.waitForDone();
+    }
+    
+    for (size_t i = 0; i < routes.size(); ++i) {
+        m_routeCache.insert(endpoints[i].first, endpoints[i].second, m_obstaclesVersion, paths[i]);
+        setRoutePath(*routes[i], std::move(paths[i]));
+    }
+}
+
+void Scene::removeDanglingRoutes()
+{
+    size_t routeCount = m_routes.size();
+    
+    // Удаляем маршруты, концы которых больше не существуют
+    m_routes.erase(
+        std::remove_if(m_routes.begin(), m_routes.end(),
+            [this](const Route& route) {
+                QPoint pos;
+                if (getPointPosition(route.getStartId(), pos) && getPointPosition(route.getEndId(), pos))
+                    return false;
+                m_routeCells.remove(route);
+                m_repairSlots.erase(route.getId());
+                m_pendingRoutes.erase(route.getId());
+                return true;
+            }),
+        m_routes.end()
+    );
+    
+    if (m_routes.size() != routeCount)
+        refreshRoutePaths();
+}
+
+void Scene::applyPlannedRoutes(const AsyncRoutePlanner::Result& result)
+{
+    std::map<int, size_t> positions;
+    for (size_t i = 0; i < result.routeIds.size(); ++i)
+        positions[result.routeIds[i]] = i;
+    
+    for (size_t i = 0; i < result.routeIds.size(); ++i)
+        m_routeCache.insert(result.endpoints[i].first, result.endpoints[i].second, result.obstaclesVersion, result.paths[i]);
+    
+    // Маршруты, удаленные за время планирования, пропускаем
+    for (auto& route : m_routes) {
+        auto it = positions.find(route.getId());
+        if (it != positions.end())
+            setRoutePath(route, result.paths[it->second]);
+    }
+    
+    m_pendingRoutes.clear();
+    refreshRoutePaths();
+    
+    if (RoutingStats::Enabled) {
+        m_routingStats.recordRebuild(static_cast<int>(result.routeIds.size()), 0,
+                                     static_cast<quint64>(m_asyncRebuildTimer.nsecsElapsed() / 1000));
+    }
+    
+    if (m_routesUpdatedHandler)
+        m_routesUpdatedHandler();
+}
+
+void Scene::refreshRoutePaths()
+{
+    // Для отрисовки достаточно точек поворота маршрутов
+    size_t pointCount = 0;
+    for (const auto& route : m_routes)
+        pointCount += route.getCorners().size();
+    
+    m_spareRoutePaths.clear();
+    m_spareRoutePaths.reserve(m_routes.size(), pointCount);
+    for (const auto& route : m_routes)
+        m_spareRoutePaths.append(route.getCorners());
+    
+    // Накапливаем область, где маршруты изменились, для частичной перерисовки
+    size_t count = std::max(m_routePaths.count(), m_spareRoutePaths.count());
+    for (size_t i = 0; i < count; ++i) {
+        bool hasOld = i < m_routePaths.count();
+        bool hasNew = i < m_spareRoutePaths.count();
+        
+        if (hasOld && hasNew) {
+            RoutePaths::PathView oldPath = m_routePaths.path(i);
+            RoutePaths::PathView newPath = m_spareRoutePaths.path(i);
+            if (oldPath.size == newPath.size && std::equal(oldPath.begin(), oldPath.end(), newPath.begin()))
+                continue;
+        }
+        
+        if (hasOld)
+            m_dirtyRect |= m_routePaths.bounds(i);
+        if (hasNew)
+            m_dirtyRect |= m_spareRoutePaths.bounds(i);
+    }
+    
+    std::swap(m_routePaths, m_spareRoutePaths);
 }
\ No newline at end of file
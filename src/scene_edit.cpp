@@ -0,0 +1,27 @@
+#include "scene_edit.h"
+
+SceneEdit::SceneEdit(IScene& scene)
+    : m_scene(scene)
+    , m_active(true)
+{
+    m_scene.beginBatch();
+}
+
+SceneEdit::~SceneEdit()
+{
+    commit();
+}
+
+IScene* SceneEdit::operator->() const
+{
+    return &m_scene;
+}
+
+void SceneEdit::commit()
+{
+    if (!m_active)
+        return;
+
+    m_active = false;
+    m_scene.commitBatch();
+}
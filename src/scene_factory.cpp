@@ -2,11 +2,60 @@
 #include "scene.h"
 #include "element_manager.h"
 #include "route_builder.h"
+#include "jps_route_builder.h"
+#include "hierarchical_route_builder.h"
+#include <algorithm>
 
-std::unique_ptr<IScene> SceneFactory::createScene()
+namespace {
+
+// Шаг сетки и цена шага положительны, наценки не отрицательны
+GridSettings sanitized(const GridSettings& settings)
+{
+    GridSettings result = settings;
+    result.cellSize = std::max(1, settings.cellSize);
+    result.stepCost = std::max(1, settings.stepCost);
+    result.nearObstacleCost = std::max(0, settings.nearObstacleCost);
+    result.turnCost = std::max(0, settings.turnCost);
+    return result;
+}
+
+}
+
+std::unique_ptr<IScene> SceneFactory::createScene(RoutingAlgorithm algorithm, const GridSettings& settings)
 {
+    const GridSettings grid = sanitized(settings);
     auto elementManager = std::make_unique<ElementManager>();
-    auto routeBuilder = std::make_unique<RouteBuilder>();
+    auto routeBuilder = createRouteBuilder(algorithm, grid);
+    
+    return std::make_unique<Scene>(std::move(elementManager), std::move(routeBuilder), grid);
+}
+
+std::unique_ptr<IRouteBuilder> SceneFactory::createRouteBuilder(RoutingAlgorithm algorithm, const GridSettings& settings)
+{
+    const GridSettings grid = sanitized(settings);
+    
+    // JPS и HPA* рассчитаны на равноценные шаги
+    const bool uniform = grid.isUniform();
+    switch (algorithm) {
+    case RoutingAlgorithm::JumpPoint:
+        if (uniform)
+            return std::make_unique<JpsRouteBuilder>(false, grid.cellSize);
+        break;
+    case RoutingAlgorithm::JumpPointTables:
+        if (uniform)
+            return std::make_unique<JpsRouteBuilder>(true, grid.cellSize);
+        break;
+    case RoutingAlgorithm::Hierarchical:
+        if (uniform)
+            return std::make_unique<HierarchicalRouteBuilder>(16, grid.cellSize);
+        break;
+    case RoutingAlgorithm::BidirectionalBfs:
+        return std::make_unique<RouteBuilder>(RouteBuilder::SearchMode::BidirectionalBfs, grid);
+    case RoutingAlgorithm::BidirectionalAStar:
+        return std::make_unique<RouteBuilder>(RouteBuilder::SearchMode::BidirectionalAStar, grid);
+    case RoutingAlgorithm::AStar:
+        break;
+    }
     
-    return std::make_unique<Scene>(std::move(elementManager), std::move(routeBuilder));
-}
\ No newline at end of file
+    return std::make_unique<RouteBuilder>(RouteBuilder::SearchMode::AStar, grid);
+}
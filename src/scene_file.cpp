@@ -0,0 +1,352 @@
+#include "scene_file.h"
+#include "scene_edit.h"
+#include <QFile>
+#include <QSaveFile>
+#include <QByteArray>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+const char kMagic[8] = { 'G', 'V', 'S', 'C', 'E', 'N', 'E', '\0' };
+const quint64 kSectionAlignment = 64;
+const quint32 kMaxSections = 256;
+
+enum SectionType : quint32 {
+    PointsSection = 1,
+    ObstaclesSection = 2,
+    RoutesSection = 3,
+    PathOffsetsSection = 4,
+    PathPointsSection = 5,
+    SettingsSection = 6
+};
+
+struct FileHeader {
+    char magic[8];
+    quint32 version;
+    quint32 sectionCount;
+    quint64 fileSize;
+    quint64 reserved;
+};
+
+struct SectionEntry {
+    quint32 type;
+    quint32 elementSize;
+    quint64 count;
+    quint64 offset;
+    quint64 reserved;
+};
+
+static_assert(sizeof(FileHeader) == 32, "FileHeader layout is part of the file format");
+static_assert(sizeof(SectionEntry) == 32, "SectionEntry layout is part of the file format");
+
+// Секция, подготовленная к записи
+struct OutputSection {
+    quint32 type;
+    quint32 elementSize;
+    quint64 count;
+    const char* data;
+};
+
+// Представление секции в отображенном файле без копирования
+template <typename T>
+struct SectionView {
+    const T* data = nullptr;
+    quint64 count = 0;
+};
+
+quint64 alignUp(quint64 value)
+{
+    return (value + kSectionAlignment - 1) / kSectionAlignment * kSectionAlignment;
+}
+
+bool fail(QString* error, const QString& message)
+{
+    if (error)
+        *error = message;
+    return false;
+}
+
+// Проверяет запись таблицы и возвращает представление секции
+template <typename T>
+bool viewSection(const SectionEntry& entry, const uchar* data, quint64 fileSize, quint32 components,
+                 SectionView<T>& view)
+{
+    const quint64 elementSize = sizeof(T) * components;
+    if (entry.elementSize != elementSize || entry.offset % kSectionAlignment != 0 || entry.offset > fileSize)
+        return false;
+    if (entry.count > (fileSize - entry.offset) / elementSize)
+        return false;
+
+    view.data = reinterpret_cast<const T*>(data + entry.offset);
+    view.count = entry.count;
+    return true;
+}
+
+}
+
+bool SceneFile::save(const IScene& scene, const QString& fileName, QString* error)
+{
+#if Q_BYTE_ORDER == Q_BIG_ENDIAN
+    return fail(error, "Scene files are only supported on little-endian hosts");
+#endif
+
+    const std::vector<int>& pointIds = scene.getPointIds();
+    const std::vector<QPoint>& positions = scene.getPointPositions();
+    const std::vector<QRect>& obstacles = scene.getObstacles();
+    const std::vector<Route>& routes = scene.getRouteList();
+    const GridSettings& grid = scene.getGridSettings();
+
+    const qint32 settings[] = { grid.cellSize, grid.stepCost, grid.nearObstacleCost, grid.turnCost };
+
+    // Маршруты ссылаются на точки по номеру в секции Points
+    std::unordered_map<int, quint32> pointIndex;
+    pointIndex.reserve(pointIds.size());
+    std::vector<qint32> points;
+    points.reserve(positions.size() * 2);
+    for (size_t i = 0; i < pointIds.size(); ++i) {
+        pointIndex[pointIds[i]] = static_cast<quint32>(i);
+        points.push_back(positions[i].x());
+        points.push_back(positions[i].y());
+    }
+
+    std::vector<qint32> rects;
+    rects.reserve(obstacles.size() * 4);
+    for (const QRect& rc : obstacles) {
+        QRect r = rc.normalized();
+        rects.push_back(r.left());
+        rects.push_back(r.top());
+        rects.push_back(r.right());
+        rects.push_back(r.bottom());
+    }
+
+    std::vector<quint32> endpoints;
+    std::vector<quint64> pathOffsets(1, 0);
+    std::vector<qint32> pathPoints;
+    endpoints.reserve(routes.size() * 2);
+    pathOffsets.reserve(routes.size() + 1);
+    for (const Route& route : routes) {
+        auto start = pointIndex.find(route.getStartId());
+        auto end = pointIndex.find(route.getEndId());
+        // Маршрут с удаленным концом будет удален при следующем перестроении
+        if (start == pointIndex.end() || end == pointIndex.end())
+            continue;
+
+        endpoints.push_back(start->second);
+        endpoints.push_back(end->second);
+        for (const QPoint& pt : route.cells()) {
+            pathPoints.push_back(pt.x());
+            pathPoints.push_back(pt.y());
+        }
+        pathOffsets.push_back(pathPoints.size() / 2);
+    }
+
+    const OutputSection sections[] = {
+        { PointsSection, 2 * sizeof(qint32), points.size() / 2, reinterpret_cast<const char*>(points.data()) },
+        { ObstaclesSection, 4 * sizeof(qint32), rects.size() / 4, reinterpret_cast<const char*>(rects.data()) },
+        { RoutesSection, 2 * sizeof(quint32), endpoints.size() / 2, reinterpret_cast<const char*>(endpoints.data()) },
+        { PathOffsetsSection, sizeof(quint64), pathOffsets.size(), reinterpret_cast<const char*>(pathOffsets.data()) },
+        { PathPointsSection, 2 * sizeof(qint32), pathPoints.size() / 2, reinterpret_cast<const char*>(pathPoints.data()) },
+        { SettingsSection, sizeof(settings), 1, reinterpret_cast<const char*>(settings) }
+    };
+    const quint32 sectionCount = sizeof(sections) / sizeof(sections[0]);
+
+    // Раскладка: заголовок, таблица секций, затем выровненные секции
+    std::vector<SectionEntry> table(sectionCount);
+    quint64 offset = sizeof(FileHeader) + sectionCount * sizeof(SectionEntry);
+    for (quint32 i = 0; i < sectionCount; ++i) {
+        offset = alignUp(offset);
+        table[i] = { sections[i].type, sections[i].elementSize, sections[i].count, offset, 0 };
+        offset += sections[i].count * sections[i].elementSize;
+    }
+
+    FileHeader header;
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = Version;
+    header.sectionCount = sectionCount;
+    header.fileSize = offset;
+    header.reserved = 0;
+
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly))
+        return fail(error, "Cannot open " + fileName + " for writing");
+
+    quint64 written = 0;
+    auto write = [&](const char* data, quint64 size) {
+        if (size == 0)
+            return true;
+        if (file.write(data, static_cast<qint64>(size)) != static_cast<qint64>(size))
+            return false;
+        written += size;
+        return true;
+    };
+
+    bool ok = write(reinterpret_cast<const char*>(&header), sizeof(header))
+           && write(reinterpret_cast<const char*>(table.data()), table.size() * sizeof(SectionEntry));
+
+    const char padding[kSectionAlignment] = {};
+    for (quint32 i = 0; ok && i < sectionCount; ++i) {
+        ok = write(padding, table[i].offset - written)
+          && write(sections[i].data, sections[i].count * sections[i].elementSize);
+    }
+
+    if (!ok || !file.commit())
+        return fail(error, "Cannot write " + fileName);
+    return true;
+}
+
+bool SceneFile::load(IScene& scene, const QString& fileName, QString* error)
+{
+#if Q_BYTE_ORDER == Q_BIG_ENDIAN
+    return fail(error, "Scene files are only supported on little-endian hosts");
+#endif
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly))
+        return fail(error, "Cannot open " + fileName);
+
+    const quint64 fileSize = static_cast<quint64>(file.size());
+    if (fileSize < sizeof(FileHeader))
+        return fail(error, fileName + " is not a scene file");
+
+    // Отображение начинается с границы страницы, поэтому выровненные секции
+    // можно читать как массивы. Если отобразить файл нельзя, читаем его целиком
+    const uchar* data = file.map(0, static_cast<qint64>(fileSize));
+    QByteArray contents;
+    if (!data) {
+        contents = file.readAll();
+        if (static_cast<quint64>(contents.size()) != fileSize)
+            return fail(error, "Cannot read " + fileName);
+        data = reinterpret_cast<const uchar*>(contents.constData());
+    }
+
+    FileHeader header;
+    std::memcpy(&header, data, sizeof(header));
+    if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0)
+        return fail(error, fileName + " is not a scene file");
+    if (header.version == 0 || header.version > Version)
+        return fail(error, fileName + " has an unsupported format version");
+    if (header.fileSize != fileSize || header.sectionCount > kMaxSections
+        || sizeof(FileHeader) + header.sectionCount * sizeof(SectionEntry) > fileSize)
+        return fail(error, fileName + " is truncated or corrupted");
+
+    SectionView<qint32> points;
+    SectionView<qint32> rects;
+    SectionView<quint32> endpoints;
+    SectionView<quint64> pathOffsets;
+    SectionView<qint32> pathPoints;
+    SectionView<qint32> settings;
+    quint32 seen = 0;
+
+    for (quint32 i = 0; i < header.sectionCount; ++i) {
+        SectionEntry entry;
+        std::memcpy(&entry, data + sizeof(FileHeader) + i * sizeof(SectionEntry), sizeof(entry));
+
+        // Неизвестные секции - расширения более новых версий формата
+        if (entry.type < PointsSection || entry.type > SettingsSection)
+            continue;
+        if (seen & (1u << entry.type))
+            return fail(error, fileName + " has duplicate sections");
+        seen |= 1u << entry.type;
+
+        bool valid = false;
+        switch (entry.type) {
+        case PointsSection:
+            valid = viewSection(entry, data, fileSize, 2, points);
+            break;
+        case ObstaclesSection:
+            valid = viewSection(entry, data, fileSize, 4, rects);
+            break;
+        case RoutesSection:
+            valid = viewSection(entry, data, fileSize, 2, endpoints);
+            break;
+        case PathOffsetsSection:
+            valid = viewSection(entry, data, fileSize, 1, pathOffsets);
+            break;
+        case PathPointsSection:
+            valid = viewSection(entry, data, fileSize, 2, pathPoints);
+            break;
+        case SettingsSection:
+            valid = viewSection(entry, data, fileSize, 4, settings) && settings.count == 1;
+            break;
+        }
+        if (!valid)
+            return fail(error, fileName + " is truncated or corrupted");
+    }
+
+    // Маршруты должны ссылаться на существующие точки и на свои пути
+    const quint64 routeCount = endpoints.count;
+    if (routeCount > 0) {
+        if (pathOffsets.count != routeCount + 1 || pathOffsets.data[0] != 0
+            || pathOffsets.data[routeCount] != pathPoints.count)
+            return fail(error, fileName + " has inconsistent route paths");
+
+        for (quint64 i = 0; i < routeCount; ++i) {
+            if (pathOffsets.data[i] > pathOffsets.data[i + 1]
+                || endpoints.data[2 * i] >= points.count || endpoints.data[2 * i + 1] >= points.count)
+                return fail(error, fileName + " has inconsistent routes");
+        }
+    }
+
+    // Файл проверен - переносим данные в сцену пакетами. Уже существующие
+    // маршруты сцены перепроверяются один раз, по завершении загрузки
+    SceneEdit edit(scene);
+    std::vector<QRect> bounds;
+    bounds.reserve(rects.count);
+    for (quint64 i = 0; i < rects.count; ++i) {
+        const qint32* r = rects.data + 4 * i;
+        bounds.push_back(QRect(QPoint(r[0], r[1]), QPoint(r[2], r[3])));
+    }
+    scene.addObstacles(bounds);
+
+    std::vector<QPoint> positions;
+    positions.reserve(points.count);
+    for (quint64 i = 0; i < points.count; ++i)
+        positions.push_back(QPoint(points.data[2 * i], points.data[2 * i + 1]));
+    int firstPointId = scene.addPoints(positions);
+
+    // Файлы версии 1 записывались с параметрами сетки по умолчанию
+    GridSettings saved;
+    if (settings.count == 1) {
+        saved.cellSize = settings.data[0];
+        saved.stepCost = settings.data[1];
+        saved.nearObstacleCost = settings.data[2];
+        saved.turnCost = settings.data[3];
+    }
+
+    // Пути, найденные с другим шагом сетки или другими стоимостями шагов,
+    // для этой сцены не кратчайшие - строим их заново
+    const GridSettings& grid = scene.getGridSettings();
+    const bool samePaths = saved.cellSize == grid.cellSize && saved.stepCost == grid.stepCost
+        && saved.nearObstacleCost == grid.nearObstacleCost && saved.turnCost == grid.turnCost;
+
+    if (!samePaths) {
+        for (quint64 i = 0; i < routeCount; ++i) {
+            const int startId = firstPointId + static_cast<int>(endpoints.data[2 * i]);
+            const int endId = firstPointId + static_cast<int>(endpoints.data[2 * i + 1]);
+            // Концы существуют, поэтому отказ - недостижимый маршрут; он сохраняется
+            if (!scene.buildRoute(startId, endId))
+                scene.addRoute(startId, endId, {});
+        }
+        return true;
+    }
+
+    // Сохраненные пути передаются сцене одним пакетом; маршрут с пустым путем
+    // был недостижим при сохранении и остается недостижимым
+    if (routeCount > 0) {
+        std::vector<int> endpointIds(2 * routeCount);
+        for (quint64 i = 0; i < 2 * routeCount; ++i)
+            endpointIds[i] = firstPointId + static_cast<int>(endpoints.data[i]);
+
+        std::vector<QPoint> routePoints;
+        routePoints.reserve(pathPoints.count);
+        for (quint64 k = 0; k < pathPoints.count; ++k)
+            routePoints.push_back(QPoint(pathPoints.data[2 * k], pathPoints.data[2 * k + 1]));
+
+        std::vector<quint64> offsets(pathOffsets.data, pathOffsets.data + routeCount + 1);
+        scene.addRoutes(endpointIds, routePoints, offsets);
+    }
+
+    return true;
+}
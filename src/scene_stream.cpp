@@ -0,0 +1,633 @@
+#include "scene_stream.h"
+#include "scene_edit.h"
+#include <QByteArray>
+#include <QFile>
+#include <QSaveFile>
+#include <algorithm>
+#include <charconv>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Размер блока чтения и записи
+const qint64 kChunkSize = 64 * 1024;
+
+// Число элементов, передаваемых в сцену одним вызовом
+const size_t kBatchSize = 4096;
+
+// Самое длинное число, которое имеет смысл разбирать как координату
+const size_t kMaxNumberLength = 64;
+
+// Самая длинная строка CSV: элемент занимает несколько десятков символов
+const size_t kMaxLineLength = 4096;
+
+// Чтение устройства блоками фиксированного размера
+class ChunkReader {
+public:
+    explicit ChunkReader(QIODevice& device)
+        : m_device(device)
+        , m_buffer(kChunkSize)
+        , m_pos(0)
+        , m_size(0)
+        , m_line(1)
+        , m_failed(false)
+    {
+    }
+
+    // Следующий символ или -1 в конце данных
+    int peek()
+    {
+        if (m_pos == m_size && !refill())
+            return -1;
+        return static_cast<unsigned char>(m_buffer[m_pos]);
+    }
+
+    int get()
+    {
+        int c = peek();
+        if (c != -1) {
+            ++m_pos;
+            if (c == '\n')
+                ++m_line;
+        }
+        return c;
+    }
+
+    int line() const
+    {
+        return m_line;
+    }
+
+    bool failed() const
+    {
+        return m_failed;
+    }
+
+private:
+    bool refill()
+    {
+        qint64 n = m_device.read(m_buffer.data(), kChunkSize);
+        if (n < 0)
+            m_failed = true;
+        m_pos = 0;
+        m_size = n > 0 ? n : 0;
+        return m_size > 0;
+    }
+
+    QIODevice& m_device;
+    std::vector<char> m_buffer;
+    qint64 m_pos;
+    qint64 m_size;
+    int m_line;
+    bool m_failed;
+};
+
+// Накопление элементов и передача их в сцену пакетами
+class BatchSink {
+public:
+    explicit BatchSink(IScene& scene)
+        : m_scene(scene)
+    {
+        m_points.reserve(kBatchSize);
+        m_obstacles.reserve(kBatchSize);
+    }
+
+    // Точки привязываются к сетке так же, как при добавлении в редакторе
+    void addPoint(const QPoint& position)
+    {
+        m_points.push_back(m_scene.snapToGrid(position));
+        if (m_points.size() >= kBatchSize)
+            flushPoints();
+    }
+
+    void addObstacle(const QRect& bounds)
+    {
+        m_obstacles.push_back(bounds);
+        if (m_obstacles.size() >= kBatchSize)
+            flushObstacles();
+    }
+
+    void flush()
+    {
+        flushPoints();
+        flushObstacles();
+    }
+
+private:
+    void flushPoints()
+    {
+        if (!m_points.empty())
+            m_scene.addPoints(m_points);
+        m_points.clear();
+    }
+
+    void flushObstacles()
+    {
+        if (!m_obstacles.empty())
+            m_scene.addObstacles(m_obstacles);
+        m_obstacles.clear();
+    }
+
+    IScene& m_scene;
+    std::vector<QPoint> m_points;
+    std::vector<QRect> m_obstacles;
+};
+
+// Буфер вывода, сбрасываемый на устройство блоками
+class ChunkWriter {
+public:
+    explicit ChunkWriter(QIODevice& device)
+        : m_device(device)
+        , m_failed(false)
+    {
+        m_buffer.reserve(kChunkSize + kMaxNumberLength);
+    }
+
+    void append(const char* text)
+    {
+        m_buffer += text;
+        flushIfFull();
+    }
+
+    void appendNumber(int value)
+    {
+        char digits[16];
+        std::to_chars_result result = std::to_chars(digits, digits + sizeof(digits), value);
+        m_buffer.append(digits, result.ptr);
+        flushIfFull();
+    }
+
+    bool finish()
+    {
+        flush();
+        return !m_failed;
+    }
+
+private:
+    void flushIfFull()
+    {
+        if (static_cast<qint64>(m_buffer.size()) >= kChunkSize)
+            flush();
+    }
+
+    void flush()
+    {
+        if (!m_failed && !m_buffer.empty()) {
+            qint64 size = static_cast<qint64>(m_buffer.size());
+            m_failed = m_device.write(m_buffer.data(), size) != size;
+        }
+        m_buffer.clear();
+    }
+
+    QIODevice& m_device;
+    std::string m_buffer;
+    bool m_failed;
+};
+
+bool isSpace(int c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+// Целое или дробное число (с округлением) в диапазоне int
+bool parseCoordinate(const char* begin, const char* end, int& value)
+{
+    while (begin != end && isSpace(*begin))
+        ++begin;
+    while (begin != end && isSpace(end[-1]))
+        --end;
+    if (begin == end)
+        return false;
+
+    // Частый случай - целое число без знака плюс
+    std::from_chars_result result = std::from_chars(begin, end, value);
+    if (result.ec == std::errc() && result.ptr == end)
+        return true;
+
+    // Дробные числа разбираются без учета локали
+    bool ok = false;
+    double number = QByteArray::fromRawData(begin, static_cast<int>(end - begin)).toDouble(&ok);
+    if (!ok || !(number >= std::numeric_limits<int>::min() && number <= std::numeric_limits<int>::max()))
+        return false;
+
+    value = qRound(number);
+    return true;
+}
+
+QString lineError(int line, const QString& message)
+{
+    return "Line " + QString::number(line) + ": " + message;
+}
+
+bool fail(QString* error, const QString& message)
+{
+    if (error)
+        *error = message;
+    return false;
+}
+
+bool importCsv(ChunkReader& reader, BatchSink& sink, QString* error)
+{
+    std::string line;
+    std::vector<std::pair<const char*, const char*>> fields;
+    bool firstRecord = true;
+
+    while (reader.peek() != -1)
+    {
+        const int lineNumber = reader.line();
+        line.clear();
+        for (int c = reader.get(); c != -1 && c != '\n'; c = reader.get()) {
+            if (line.size() >= kMaxLineLength)
+                return fail(error, lineError(lineNumber, "line is too long"));
+            line.push_back(static_cast<char>(c));
+        }
+
+        // Поля строки - участки между запятыми
+        fields.clear();
+        const char* begin = line.data();
+        const char* end = begin + line.size();
+        for (const char* field = begin; ; ) {
+            const char* comma = std::find(field, end, ',');
+            fields.push_back({ field, comma });
+            if (comma == end)
+                break;
+            field = comma + 1;
+        }
+
+        std::string type(fields[0].first, fields[0].second);
+        size_t first = type.find_first_not_of(" \t\r");
+        size_t last = type.find_last_not_of(" \t\r");
+        type = first == std::string::npos ? std::string() : type.substr(first, last - first + 1);
+
+        if (type.empty() || type[0] == '#')
+            continue;
+
+        // Первая запись может быть строкой заголовка
+        bool isHeader = firstRecord && type == "type";
+        firstRecord = false;
+        if (isHeader)
+            continue;
+
+        int values[4] = {};
+        const size_t expected = type == "point" ? 2 : type == "obstacle" ? 4 : 0;
+        if (expected == 0)
+            return fail(error, lineError(lineNumber, "unknown element type '" + QString::fromStdString(type) + "'"));
+        if (fields.size() - 1 < expected)
+            return fail(error, lineError(lineNumber, "too few fields"));
+
+        for (size_t i = 0; i < expected; ++i) {
+            if (!parseCoordinate(fields[i + 1].first, fields[i + 1].second, values[i]))
+                return fail(error, lineError(lineNumber, "invalid number"));
+        }
+
+        if (expected == 2)
+            sink.addPoint(QPoint(values[0], values[1]));
+        else
+            sink.addObstacle(QRect(values[0], values[1], values[2], values[3]));
+    }
+
+    return true;
+}
+
+// Разбор JSON без построения документа: элементы передаются в сцену по мере чтения
+class JsonImporter {
+public:
+    JsonImporter(ChunkReader& reader, BatchSink& sink)
+        : m_reader(reader)
+        , m_sink(sink)
+    {
+    }
+
+    bool run(QString* error)
+    {
+        bool ok = parseDocument();
+        if (!ok && error)
+            *error = lineError(m_reader.line(), m_error);
+        return ok;
+    }
+
+private:
+    bool parseDocument()
+    {
+        if (!expect('{'))
+            return false;
+
+        skipSpace();
+        if (m_reader.peek() == '}') {
+            m_reader.get();
+        } else {
+            std::string key;
+            while (true)
+            {
+                if (!readString(&key) || !expect(':'))
+                    return false;
+
+                bool ok = true;
+                if (key == "points")
+                    ok = readElements(2);
+                else if (key == "obstacles")
+                    ok = readElements(4);
+                else
+                    ok = skipValue();
+                if (!ok)
+                    return false;
+
+                skipSpace();
+                int c = m_reader.get();
+                if (c == '}')
+                    break;
+                if (c != ',')
+                    return error("expected ',' or '}'");
+            }
+        }
+
+        skipSpace();
+        if (m_reader.peek() != -1)
+            return error("unexpected data after the document");
+        return true;
+    }
+
+    // Массив элементов, каждый - массив из count чисел
+    bool readElements(int count)
+    {
+        if (!expect('['))
+            return false;
+
+        skipSpace();
+        if (m_reader.peek() == ']') {
+            m_reader.get();
+            return true;
+        }
+
+        int values[4];
+        while (true)
+        {
+            if (!expect('['))
+                return false;
+            for (int i = 0; i < count; ++i) {
+                if (i > 0 && !expect(','))
+                    return false;
+                if (!readNumber(values[i]))
+                    return false;
+            }
+            if (!expect(']'))
+                return false;
+
+            if (count == 2)
+                m_sink.addPoint(QPoint(values[0], values[1]));
+            else
+                m_sink.addObstacle(QRect(values[0], values[1], values[2], values[3]));
+
+            skipSpace();
+            int c = m_reader.get();
+            if (c == ']')
+                return true;
+            if (c != ',')
+                return error("expected ',' or ']'");
+        }
+    }
+
+    bool readNumber(int& value)
+    {
+        skipSpace();
+        readToken();
+        if (m_token.empty())
+            return error("expected a number");
+        if (!parseCoordinate(m_token.data(), m_token.data() + m_token.size(), value))
+            return error("invalid number");
+        return true;
+    }
+
+    // Строка; escape-последовательности сохраняются как есть, ключам они не нужны
+    bool readString(std::string* out)
+    {
+        if (!expect('"'))
+            return false;
+        if (out)
+            out->clear();
+
+        while (true)
+        {
+            int c = m_reader.get();
+            if (c == -1)
+                return error("unterminated string");
+            if (c == '"')
+                return true;
+            if (c == '\\') {
+                if (out)
+                    out->push_back('\\');
+                c = m_reader.get();
+                if (c == -1)
+                    return error("unterminated string");
+            }
+            if (out)
+                out->push_back(static_cast<char>(c));
+        }
+    }
+
+    // Пропуск значения неизвестного ключа с любой вложенностью
+    bool skipValue()
+    {
+        skipSpace();
+        int c = m_reader.peek();
+        if (c == '"')
+            return readString(nullptr);
+
+        if (c != '{' && c != '[')
+            return skipToken() || error("expected a value");
+
+        int depth = 0;
+        do {
+            c = m_reader.peek();
+            if (c == -1)
+                return error("unexpected end of data");
+            if (c == '"') {
+                if (!readString(nullptr))
+                    return false;
+                continue;
+            }
+
+            m_reader.get();
+            if (c == '{' || c == '[')
+                ++depth;
+            else if (c == '}' || c == ']')
+                --depth;
+        } while (depth > 0);
+        return true;
+    }
+
+    // Скалярный токен: число, true, false или null
+    void readToken()
+    {
+        m_token.clear();
+        for (int c = m_reader.peek(); c != -1 && !isSpace(c) && c != ',' && c != ']' && c != '}'; c = m_reader.peek()) {
+            if (m_token.size() > kMaxNumberLength)
+                break;
+            m_token.push_back(static_cast<char>(m_reader.get()));
+        }
+    }
+
+    // Пропуск скалярного токена любой длины без сохранения
+    bool skipToken()
+    {
+        bool skipped = false;
+        for (int c = m_reader.peek(); c != -1 && !isSpace(c) && c != ',' && c != ']' && c != '}'; c = m_reader.peek()) {
+            m_reader.get();
+            skipped = true;
+        }
+        return skipped;
+    }
+
+    void skipSpace()
+    {
+        while (isSpace(m_reader.peek()))
+            m_reader.get();
+    }
+
+    bool expect(char expected)
+    {
+        skipSpace();
+        if (m_reader.get() != expected)
+            return error(QString("expected '") + QString::fromLatin1(&expected, 1) + "'");
+        return true;
+    }
+
+    bool error(const QString& message)
+    {
+        m_error = message;
+        return false;
+    }
+
+    ChunkReader& m_reader;
+    BatchSink& m_sink;
+    std::string m_token;
+    QString m_error;
+};
+
+void exportCsv(const IScene& scene, ChunkWriter& writer)
+{
+    writer.append("type,x,y,width,height\n");
+
+    for (const QPoint& pt : scene.getPointPositions()) {
+        writer.append("point,");
+        writer.appendNumber(pt.x());
+        writer.append(",");
+        writer.appendNumber(pt.y());
+        writer.append("\n");
+    }
+
+    for (const QRect& rc : scene.getObstacles()) {
+        writer.append("obstacle,");
+        writer.appendNumber(rc.x());
+        writer.append(",");
+        writer.appendNumber(rc.y());
+        writer.append(",");
+        writer.appendNumber(rc.width());
+        writer.append(",");
+        writer.appendNumber(rc.height());
+        writer.append("\n");
+    }
+}
+
+void exportJson(const IScene& scene, ChunkWriter& writer)
+{
+    writer.append("{\n  \"points\": [");
+
+    const char* separator = "\n    ";
+    for (const QPoint& pt : scene.getPointPositions()) {
+        writer.append(separator);
+        writer.append("[");
+        writer.appendNumber(pt.x());
+        writer.append(", ");
+        writer.appendNumber(pt.y());
+        writer.append("]");
+        separator = ",\n    ";
+    }
+
+    writer.append("\n  ],\n  \"obstacles\": [");
+
+    separator = "\n    ";
+    for (const QRect& rc : scene.getObstacles()) {
+        writer.append(separator);
+        writer.append("[");
+        writer.appendNumber(rc.x());
+        writer.append(", ");
+        writer.appendNumber(rc.y());
+        writer.append(", ");
+        writer.appendNumber(rc.width());
+        writer.append(", ");
+        writer.appendNumber(rc.height());
+        writer.append("]");
+        separator = ",\n    ";
+    }
+
+    writer.append("\n  ]\n}\n");
+}
+
+SceneStream::Format formatOf(const QString& fileName)
+{
+    return fileName.endsWith(".json", Qt::CaseInsensitive) ? SceneStream::Format::Json : SceneStream::Format::Csv;
+}
+
+}
+
+bool SceneStream::importScene(IScene& scene, QIODevice& device, Format format, QString* error)
+{
+    // Маршруты перестраиваются один раз, когда пакет закрывается
+    SceneEdit edit(scene);
+    ChunkReader reader(device);
+    BatchSink sink(scene);
+
+    bool ok = false;
+    if (format == Format::Json) {
+        JsonImporter importer(reader, sink);
+        ok = importer.run(error);
+    } else {
+        ok = importCsv(reader, sink, error);
+    }
+
+    // Прочитанное до ошибки тоже попадает в сцену
+    sink.flush();
+    edit.commit();
+
+    if (ok && reader.failed())
+        return fail(error, "Read error");
+    return ok;
+}
+
+bool SceneStream::exportScene(const IScene& scene, QIODevice& device, Format format, QString* error)
+{
+    ChunkWriter writer(device);
+    if (format == Format::Json)
+        exportJson(scene, writer);
+    else
+        exportCsv(scene, writer);
+
+    if (!writer.finish())
+        return fail(error, "Write error");
+    return true;
+}
+
+bool SceneStream::importFile(IScene& scene, const QString& fileName, QString* error)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly))
+        return fail(error, "Cannot open " + fileName);
+
+    return importScene(scene, file, formatOf(fileName), error);
+}
+
+bool SceneStream::exportFile(const IScene& scene, const QString& fileName, QString* error)
+{
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly))
+        return fail(error, "Cannot open " + fileName + " for writing");
+
+    if (!exportScene(scene, file, formatOf(fileName), error))
+        return false;
+    if (!file.commit())
+        return fail(error, "Cannot write " + fileName);
+    return true;
+}
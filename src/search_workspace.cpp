@@ -0,0 +1,48 @@
+#include "search_workspace.h"
+#include <algorithm>
+
+SearchWorkspace::SearchWorkspace()
+    : m_generation(0)
+{
+}
+
+void SearchWorkspace::reset(int nodeCount)
+{
+    const size_t count = static_cast<size_t>(nodeCount);
+
+    // Массивы только растут: новые узлы получают поколение 0, которое
+    // никогда не бывает текущим
+    if (m_nodes.size() < count) {
+        m_nodes.resize(count, Node{ 0, 0, -1 });
+        m_marks.resize(count, 0);
+    }
+    if (m_queue.capacity() < count)
+        m_queue.reserve(count);
+
+    // При переполнении счетчика старые пометки могли бы совпасть с новым
+    // поколением - один раз сбрасываем их явно
+    if (++m_generation == 0) {
+        for (Node& node : m_nodes)
+            node.generation = 0;
+        std::fill(m_marks.begin(), m_marks.end(), 0);
+        m_generation = 1;
+    }
+
+    m_open.clear();
+    m_queue.clear();
+}
+
+std::vector<SearchWorkspace::OpenNode>& SearchWorkspace::open()
+{
+    return m_open;
+}
+
+std::vector<int>& SearchWorkspace::queue()
+{
+    return m_queue;
+}
+
+BucketQueue& SearchWorkspace::buckets()
+{
+    return m_buckets;
+}